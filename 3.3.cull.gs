@@ -0,0 +1,18 @@
+#version 330 core
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in vec4 vOffsetScale[];
+in float vVisible[];
+
+out vec4 outOffsetScale;
+
+void main()
+{
+    if (vVisible[0] > 0.5)
+    {
+        outOffsetScale = vOffsetScale[0];
+        EmitVertex();
+        EndPrimitive();
+    }
+}
@@ -0,0 +1,23 @@
+#version 330 core
+layout (location = 0) in vec4 aOffsetScale;
+
+uniform vec4 frustumPlanes[6];
+uniform float boundingRadius;
+
+out vec4 vOffsetScale;
+out float vVisible;
+
+void main()
+{
+    vec3 center = aOffsetScale.xyz;
+    float radius = boundingRadius * aOffsetScale.w;
+
+    vVisible = 1.0;
+    for (int i = 0; i < 6; ++i)
+    {
+        vec4 plane = frustumPlanes[i];
+        if (dot(plane.xyz, center) + plane.w < -radius * length(plane.xyz))
+            vVisible = 0.0;
+    }
+    vOffsetScale = aOffsetScale;
+}
@@ -0,0 +1,18 @@
+#version 330 core
+layout (location = 0) out uvec2 Feedback;
+
+in vec2 TexCoord;
+
+uniform uint textureId;
+uniform vec2 textureExtent;
+uniform float mipBias;
+
+void main()
+{
+    // Same level selection as the sampler, from texel-space derivatives.
+    vec2 texel = TexCoord * textureExtent;
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float level = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + mipBias;
+    Feedback = uvec2(textureId, uint(clamp(floor(level), 0.0, 15.0)));
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec4 aOffsetScale;
+
+out vec3 ourColor;
+out vec2 TexCoord;
+
+void main()
+{
+    gl_Position = vec4(aPos * aOffsetScale.w + aOffsetScale.xyz, 1.0);
+    ourColor = aColor;
+    TexCoord = aTexCoord;
+}
@@ -0,0 +1,34 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D physicalCache;
+uniform sampler2D indirection;
+uniform float virtualSize;    // padded level 0 edge in texels
+uniform vec2 contentScale;    // image size / virtualSize
+uniform float tileSize;
+uniform float tileBorder;
+uniform float maxLevel;
+uniform float cacheSize;
+
+vec4 sampleVirtual(vec2 uv)
+{
+    uv = clamp(uv, 0.0, 0.99999) * contentScale;
+    vec2 texel = uv * virtualSize;
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float level = clamp(floor(0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8))), 0.0, maxLevel);
+
+    // xy: cache page, z: level of the tile actually resident there.
+    vec3 entry = floor(textureLod(indirection, uv, level).xyz * 255.0 + 0.5);
+    vec2 levelTexel = uv * virtualSize / exp2(entry.z);
+    vec2 inTile = levelTexel - floor(levelTexel / tileSize) * tileSize;
+    vec2 cacheTexel = entry.xy * (tileSize + 2.0 * tileBorder) + tileBorder + inTile;
+    return textureLod(physicalCache, cacheTexel / cacheSize, 0.0);
+}
+
+void main()
+{
+    FragColor = sampleVirtual(TexCoord);
+}
@@ -2,27 +2,20 @@
 #include <GLFW/glfw3.h> 
 #include <iostream>
 #include "Shader.h"
-#include "stb_image.h"
-
-enum PrimitiveShape { Triangle, Rectangle };
-
-struct PrimitiveBuffers {
-    unsigned int VAO[2];
-    unsigned int VBO[2];
-    unsigned int EBO;
-    bool useEBO;
-};
+#include "Primitives.h"
+#include "Culling.h"
+#include "OcclusionCuller.h"
+#include "FrameArena.h"
+#include "GpuMemory.h"
+#include "Texture.h"
+#include <vector>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
-PrimitiveBuffers setupPrimitive(PrimitiveShape shape);
-unsigned int loadTexture(const char* path);
 
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
-unsigned int texture1, texture2;
-
 float mixValue = 0.2f;
 
 int main()
@@ -52,86 +45,68 @@ int main()
 
     Shader ourShader("3.3.shader.vs", "3.3.shader.fs");
 
-    texture1 = loadTexture("resources/container.jpg");
-    texture2 = loadTexture("resources/awesomeface.png");
+    GpuMemory::shared().setBudget(256u << 20);
+    TextureCache textures;
+    size_t texture1 = textures.load("resources/container.jpg");
+    size_t texture2 = textures.load("resources/awesomeface.png");
+
+    VertexFormat vertexFormat = VertexHalf;
+    if (!vertexFormatMatchesProgram(vertexFormat, ourShader.id()))
+    {
+        // Full floats feed any float attribute the shader declares.
+        std::cout << "ERROR::VERTEX_FORMAT::PROGRAM_MISMATCH: falling back to float vertices" << std::endl;
+        vertexFormat = VertexFloat;
+    }
+    PrimitiveCache primitiveCache;
+    const PrimitiveBuffers& buffers = primitiveCache.get(rectangleDesc(2.0f), vertexFormat);
 
-    PrimitiveBuffers buffers = setupPrimitive(Rectangle);
+    // The vertex shader draws straight into clip space, so the view frustum
+    // is the identity one.
+    const float identity[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+    CullingSystem culling;
+    culling.add(buffers.boundsMin, buffers.boundsMax);
+    OcclusionCuller occlusion;
+    std::vector<unsigned int> visible;
 
     ourShader.use();
-    glUniform1i(glGetUniformLocation(ourShader.ID, "texture1"), 0); 
-    glUniform1i(glGetUniformLocation(ourShader.ID, "texture2"), 1);
+    glUniform1i(glGetUniformLocation(ourShader.id(), "texture1"), 0); 
+    glUniform1i(glGetUniformLocation(ourShader.id(), "texture2"), 1);
 
     while (!glfwWindowShouldClose(window))
     {
+        FrameArena::shared().beginFrame();
         processInput(window);
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
+        glBindTexture(GL_TEXTURE_2D, textures.use(texture1));
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture2);
+        glBindTexture(GL_TEXTURE_2D, textures.use(texture2));
 
         ourShader.use();
         ourShader.setFloat("mixValue", mixValue);
 
-        if (buffers.useEBO) {
-            glBindVertexArray(buffers.VAO[0]);
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        }
-        else {
-            glBindVertexArray(buffers.VAO[0]);
-            glDrawArrays(GL_TRIANGLES, 0, 3);
-        }
+        culling.cull(extractFrustum(identity), visible);
+        occlusion.beginFrame(identity);
+        occlusion.rasterize(&ThreadPool::shared());
+        occlusion.filter(culling, visible);
+        if (!visible.empty())
+            drawPrimitive(buffers);
 
         glfwSwapBuffers(window);
         glfwPollEvents();
+        textures.enforceBudget();
+        GpuResources::shared().endFrame();
     }
 
-    glDeleteVertexArrays(2, buffers.VAO);
-    glDeleteBuffers(2, buffers.VBO);
-    if (buffers.useEBO) glDeleteBuffers(1, &buffers.EBO);
+    primitiveCache.clear();
+    GpuResources::shared().shutdown();
 
     glfwTerminate();
     return 0;
 }
 
-unsigned int loadTexture(const char* path)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true); 
-    unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
-    if (data)
-    {
-        GLenum format = GL_RGB;
-        if (nrChannels == 1)
-            format = GL_RED;
-        else if (nrChannels == 3)
-            format = GL_RGB;
-        else if (nrChannels == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    }
-    else
-    {
-        std::cout << "Failed to load texture: " << path << std::endl;
-    }
-    stbi_image_free(data);
-
-    return textureID;
-}
-
 void processInput(GLFWwindow* window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -154,62 +129,3 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
 }
-
-PrimitiveBuffers setupPrimitive(PrimitiveShape shape) {
-    PrimitiveBuffers buffers = {};
-    buffers.useEBO = false;
-    float tiling = 2.0;
-
-    float triangleVertices[] = {
-         0.5f, -0.5f, 0.0f,  1.0f, 0.0f, 0.0f,
-        -0.5f, -0.5f, 0.0f,  0.0f, 1.0f, 0.0f,
-         0.0f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f
-    };
-
-    float rectangleVertices[] = {
-         0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0 * tiling, 1.0 * tiling,
-         0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0 * tiling, 0.0f,
-        -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f,
-        -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0 * tiling
-    };
-
-    unsigned int rectangleIndices[] = {
-        0, 1, 3,
-        1, 2, 3
-    };
-
-    glGenVertexArrays(2, buffers.VAO);
-    glGenBuffers(2, buffers.VBO);
-
-    auto setupVAO = [shape](unsigned int vao, unsigned int vbo, const float* data, size_t size) {
-        float stride = (shape == Triangle) ? 6 * sizeof(float) : 8 * sizeof(float);
-
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-        glEnableVertexAttribArray(0);
-
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-
-        if (shape == Rectangle) {
-            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
-            glEnableVertexAttribArray(2);
-        }
-    };
-
-    if (shape == Triangle) {
-        setupVAO(buffers.VAO[0], buffers.VBO[0], triangleVertices, sizeof(triangleVertices));
-    }
-    else {
-        setupVAO(buffers.VAO[0], buffers.VBO[0], rectangleVertices, sizeof(rectangleVertices));
-        buffers.useEBO = true;
-        glGenBuffers(1, &buffers.EBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(rectangleIndices), rectangleIndices, GL_STATIC_DRAW);
-    }
-
-    return buffers;
-}
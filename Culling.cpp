@@ -0,0 +1,412 @@
+#include "Culling.h"
+#include "FrameArena.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
+
+Frustum extractFrustum(const float* m)
+{
+    Frustum frustum;
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int k = 0; k < 4; ++k)
+        {
+            float row = m[k * 4 + i];
+            float w = m[k * 4 + 3];
+            frustum.planes[i * 2][k] = w + row;
+            frustum.planes[i * 2 + 1][k] = w - row;
+        }
+    }
+    return frustum;
+}
+
+Frustum viewportFrustum2D(float left, float right, float bottom, float top)
+{
+    Frustum frustum = {};
+    const float planes[6][4] = {
+        {  1.0f,  0.0f, 0.0f, -left },
+        { -1.0f,  0.0f, 0.0f,  right },
+        {  0.0f,  1.0f, 0.0f, -bottom },
+        {  0.0f, -1.0f, 0.0f,  top },
+        {  0.0f,  0.0f, 0.0f,  1.0f },
+        {  0.0f,  0.0f, 0.0f,  1.0f }
+    };
+    std::copy(&planes[0][0], &planes[0][0] + 24, &frustum.planes[0][0]);
+    return frustum;
+}
+
+static bool boxVisible(const Frustum& frustum, const float center[3], const float extent[3])
+{
+    for (int p = 0; p < 6; ++p)
+    {
+        const float* plane = frustum.planes[p];
+        float distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+        float radius = std::fabs(plane[0]) * extent[0] + std::fabs(plane[1]) * extent[1] + std::fabs(plane[2]) * extent[2];
+        if (distance + radius < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+unsigned int CullingSystem::add(const float boundsMin[3], const float boundsMax[3])
+{
+    unsigned int id = (unsigned int)count++;
+    // Storage is padded to a multiple of 8 so the SIMD loop never reads past
+    // the end; padding boxes are skipped when visibility bits are collected.
+    size_t padded = (count + 7) & ~(size_t)7;
+    for (std::vector<float>* stream : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ })
+        stream->resize(padded, 0.0f);
+    itemLeaf.push_back(~0u);
+    // The new box is in no leaf, so cullBvh() falls back to cull() until
+    // the hierarchy is rebuilt.
+    staleBvh = true;
+    update(id, boundsMin, boundsMax);
+    return id;
+}
+
+void CullingSystem::update(unsigned int id, const float boundsMin[3], const float boundsMax[3])
+{
+    centerX[id] = 0.5f * (boundsMin[0] + boundsMax[0]);
+    centerY[id] = 0.5f * (boundsMin[1] + boundsMax[1]);
+    centerZ[id] = 0.5f * (boundsMin[2] + boundsMax[2]);
+    extentX[id] = 0.5f * (boundsMax[0] - boundsMin[0]);
+    extentY[id] = 0.5f * (boundsMax[1] - boundsMin[1]);
+    extentZ[id] = 0.5f * (boundsMax[2] - boundsMin[2]);
+
+    if (itemLeaf[id] != ~0u)
+        dirtyLeaves.push_back(itemLeaf[id]);
+}
+
+void CullingSystem::bounds(unsigned int id, float boundsMin[3], float boundsMax[3]) const
+{
+    boundsMin[0] = centerX[id] - extentX[id];
+    boundsMin[1] = centerY[id] - extentY[id];
+    boundsMin[2] = centerZ[id] - extentZ[id];
+    boundsMax[0] = centerX[id] + extentX[id];
+    boundsMax[1] = centerY[id] + extentY[id];
+    boundsMax[2] = centerZ[id] + extentZ[id];
+}
+
+void CullingSystem::clear()
+{
+    for (std::vector<float>* stream : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ })
+        stream->clear();
+    count = 0;
+    bvhNodes.clear();
+    bvhItems.clear();
+    itemLeaf.clear();
+    dirtyLeaves.clear();
+    staleBvh = true;
+}
+
+size_t CullingSystem::cullRange(const Frustum& frustum, size_t begin, size_t end, unsigned int* out) const
+{
+    size_t written = 0;
+    size_t i = begin;
+#if defined(SIMD_AVX2)
+    __m256 planeA[6], planeB[6], planeC[6], planeD[6], absA[6], absB[6], absC[6];
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    for (int p = 0; p < 6; ++p)
+    {
+        planeA[p] = _mm256_set1_ps(frustum.planes[p][0]);
+        planeB[p] = _mm256_set1_ps(frustum.planes[p][1]);
+        planeC[p] = _mm256_set1_ps(frustum.planes[p][2]);
+        planeD[p] = _mm256_set1_ps(frustum.planes[p][3]);
+        absA[p] = _mm256_andnot_ps(signMask, planeA[p]);
+        absB[p] = _mm256_andnot_ps(signMask, planeB[p]);
+        absC[p] = _mm256_andnot_ps(signMask, planeC[p]);
+    }
+    for (; i + 8 <= end || (i < end && i + 8 <= centerX.size()); i += 8)
+    {
+        __m256 cx = _mm256_loadu_ps(&centerX[i]), cy = _mm256_loadu_ps(&centerY[i]), cz = _mm256_loadu_ps(&centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&extentX[i]), ey = _mm256_loadu_ps(&extentY[i]), ez = _mm256_loadu_ps(&extentZ[i]);
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < 6; ++p)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeA[p], cx), _mm256_mul_ps(planeB[p], cy)),
+                _mm256_add_ps(_mm256_mul_ps(planeC[p], cz), planeD[p]));
+            __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absA[p], ex), _mm256_mul_ps(absB[p], ey)),
+                _mm256_mul_ps(absC[p], ez));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+        unsigned int mask = ~(unsigned int)_mm256_movemask_ps(outside) & 0xffu;
+        while (mask)
+        {
+            unsigned int bit = 0;
+            while (!(mask & (1u << bit))) ++bit;
+            mask &= mask - 1;
+            if (i + bit < end)
+                out[written++] = (unsigned int)(i + bit);
+        }
+    }
+#elif defined(SIMD_SSE2)
+    __m128 planeA[6], planeB[6], planeC[6], planeD[6], absA[6], absB[6], absC[6];
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    for (int p = 0; p < 6; ++p)
+    {
+        planeA[p] = _mm_set1_ps(frustum.planes[p][0]);
+        planeB[p] = _mm_set1_ps(frustum.planes[p][1]);
+        planeC[p] = _mm_set1_ps(frustum.planes[p][2]);
+        planeD[p] = _mm_set1_ps(frustum.planes[p][3]);
+        absA[p] = _mm_andnot_ps(signMask, planeA[p]);
+        absB[p] = _mm_andnot_ps(signMask, planeB[p]);
+        absC[p] = _mm_andnot_ps(signMask, planeC[p]);
+    }
+    for (; i + 4 <= end || (i < end && i + 4 <= centerX.size()); i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&centerX[i]), cy = _mm_loadu_ps(&centerY[i]), cz = _mm_loadu_ps(&centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&extentX[i]), ey = _mm_loadu_ps(&extentY[i]), ez = _mm_loadu_ps(&extentZ[i]);
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeA[p], cx), _mm_mul_ps(planeB[p], cy)),
+                _mm_add_ps(_mm_mul_ps(planeC[p], cz), planeD[p]));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absA[p], ex), _mm_mul_ps(absB[p], ey)), _mm_mul_ps(absC[p], ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+        unsigned int mask = ~(unsigned int)_mm_movemask_ps(outside) & 0xfu;
+        for (unsigned int bit = 0; bit < 4; ++bit)
+        {
+            if ((mask & (1u << bit)) && i + bit < end)
+                out[written++] = (unsigned int)(i + bit);
+        }
+    }
+#endif
+    for (; i < end; ++i)
+    {
+        const float center[3] = { centerX[i], centerY[i], centerZ[i] };
+        const float extent[3] = { extentX[i], extentY[i], extentZ[i] };
+        if (boxVisible(frustum, center, extent))
+            out[written++] = (unsigned int)i;
+    }
+    return written;
+}
+
+void CullingSystem::cull(const Frustum& frustum, std::vector<unsigned int>& visible, ThreadPool* pool) const
+{
+    const size_t rangeSize = 16384;
+    if (!pool || count <= rangeSize)
+    {
+        visible.resize(count);
+        visible.resize(cullRange(frustum, 0, count, visible.data()));
+        return;
+    }
+
+    size_t rangeCount = (count + rangeSize - 1) / rangeSize;
+    FrameVector<FrameVector<unsigned int>> partial(rangeCount);
+    pool->parallelFor(rangeCount, [&](size_t begin, size_t end)
+    {
+        for (size_t r = begin; r < end; ++r)
+        {
+            size_t rangeEnd = std::min(count, (r + 1) * rangeSize);
+            partial[r].resize(rangeEnd - r * rangeSize);
+            partial[r].resize(cullRange(frustum, r * rangeSize, rangeEnd, partial[r].data()));
+        }
+    });
+    visible.clear();
+    for (const FrameVector<unsigned int>& part : partial)
+        visible.insert(visible.end(), part.begin(), part.end());
+}
+
+void CullingSystem::buildBvh(unsigned int leafSize)
+{
+    bvhNodes.clear();
+    dirtyLeaves.clear();
+    staleBvh = false;
+    bvhItems.resize(count);
+    for (size_t i = 0; i < count; ++i)
+        bvhItems[i] = (unsigned int)i;
+    if (count == 0)
+        return;
+
+    bvhNodes.reserve(2 * count / std::max(leafSize, 1u) + 1);
+    buildNode(~0u, 0, (unsigned int)count, std::max(leafSize, 1u));
+}
+
+unsigned int CullingSystem::buildNode(unsigned int parent, unsigned int first, unsigned int itemCount, unsigned int leafSize)
+{
+    unsigned int nodeIndex = (unsigned int)bvhNodes.size();
+    bvhNodes.push_back(BvhNode());
+    bvhNodes[nodeIndex].parent = parent;
+    bvhNodes[nodeIndex].second = 0;
+
+    float centroidMin[3] = { INFINITY, INFINITY, INFINITY };
+    float centroidMax[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (unsigned int i = first; i < first + itemCount; ++i)
+    {
+        unsigned int item = bvhItems[i];
+        const float c[3] = { centerX[item], centerY[item], centerZ[item] };
+        for (int k = 0; k < 3; ++k)
+        {
+            centroidMin[k] = std::min(centroidMin[k], c[k]);
+            centroidMax[k] = std::max(centroidMax[k], c[k]);
+        }
+    }
+
+    if (itemCount <= leafSize)
+    {
+        bvhNodes[nodeIndex].first = first;
+        bvhNodes[nodeIndex].itemCount = itemCount;
+        for (unsigned int i = first; i < first + itemCount; ++i)
+            itemLeaf[bvhItems[i]] = nodeIndex;
+        refitNode(nodeIndex);
+        return nodeIndex;
+    }
+
+    // Median split on the widest centroid axis.
+    int axis = 0;
+    for (int k = 1; k < 3; ++k)
+        if (centroidMax[k] - centroidMin[k] > centroidMax[axis] - centroidMin[axis])
+            axis = k;
+    const std::vector<float>& key = axis == 0 ? centerX : (axis == 1 ? centerY : centerZ);
+    unsigned int half = itemCount / 2;
+    std::nth_element(bvhItems.begin() + first, bvhItems.begin() + first + half, bvhItems.begin() + first + itemCount,
+        [&key](unsigned int a, unsigned int b) { return key[a] < key[b]; });
+
+    unsigned int left = buildNode(nodeIndex, first, half, leafSize);
+    unsigned int right = buildNode(nodeIndex, first + half, itemCount - half, leafSize);
+    bvhNodes[nodeIndex].first = left;
+    bvhNodes[nodeIndex].second = right;
+    bvhNodes[nodeIndex].itemCount = 0;
+    refitNode(nodeIndex);
+    return nodeIndex;
+}
+
+void CullingSystem::refitNode(unsigned int nodeIndex)
+{
+    BvhNode& node = bvhNodes[nodeIndex];
+    float boundsMin[3] = { INFINITY, INFINITY, INFINITY };
+    float boundsMax[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+    if (node.itemCount > 0)
+    {
+        for (unsigned int i = node.first; i < node.first + node.itemCount; ++i)
+        {
+            unsigned int item = bvhItems[i];
+            const float c[3] = { centerX[item], centerY[item], centerZ[item] };
+            const float e[3] = { extentX[item], extentY[item], extentZ[item] };
+            for (int k = 0; k < 3; ++k)
+            {
+                boundsMin[k] = std::min(boundsMin[k], c[k] - e[k]);
+                boundsMax[k] = std::max(boundsMax[k], c[k] + e[k]);
+            }
+        }
+    }
+    else
+    {
+        const BvhNode& left = bvhNodes[node.first];
+        const BvhNode& right = bvhNodes[node.second];
+        for (int k = 0; k < 3; ++k)
+        {
+            boundsMin[k] = std::min(left.boundsMin[k], right.boundsMin[k]);
+            boundsMax[k] = std::max(left.boundsMax[k], right.boundsMax[k]);
+        }
+    }
+
+    std::copy(boundsMin, boundsMin + 3, node.boundsMin);
+    std::copy(boundsMax, boundsMax + 3, node.boundsMax);
+}
+
+void CullingSystem::refitBvh()
+{
+    std::sort(dirtyLeaves.begin(), dirtyLeaves.end());
+    dirtyLeaves.erase(std::unique(dirtyLeaves.begin(), dirtyLeaves.end()), dirtyLeaves.end());
+
+    // Walk each dirty leaf towards the root, stopping as soon as a node's
+    // bounds come out unchanged.
+    for (unsigned int leaf : dirtyLeaves)
+    {
+        unsigned int node = leaf;
+        while (node != ~0u)
+        {
+            BvhNode before = bvhNodes[node];
+            refitNode(node);
+            const BvhNode& after = bvhNodes[node];
+            if (node != leaf && std::equal(before.boundsMin, before.boundsMin + 3, after.boundsMin)
+                && std::equal(before.boundsMax, before.boundsMax + 3, after.boundsMax))
+                break;
+            node = after.parent;
+        }
+    }
+    dirtyLeaves.clear();
+}
+
+template <typename Container>
+void CullingSystem::cullNode(const Frustum& frustum, unsigned int nodeIndex, Container& visible) const
+{
+    const BvhNode& node = bvhNodes[nodeIndex];
+    float center[3], extent[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        center[k] = 0.5f * (node.boundsMin[k] + node.boundsMax[k]);
+        extent[k] = 0.5f * (node.boundsMax[k] - node.boundsMin[k]);
+    }
+    if (!boxVisible(frustum, center, extent))
+        return;
+
+    if (node.itemCount > 0)
+    {
+        for (unsigned int i = node.first; i < node.first + node.itemCount; ++i)
+        {
+            unsigned int item = bvhItems[i];
+            const float c[3] = { centerX[item], centerY[item], centerZ[item] };
+            const float e[3] = { extentX[item], extentY[item], extentZ[item] };
+            if (boxVisible(frustum, c, e))
+                visible.push_back(item);
+        }
+        return;
+    }
+
+    cullNode(frustum, node.first, visible);
+    cullNode(frustum, node.second, visible);
+}
+
+void CullingSystem::cullBvh(const Frustum& frustum, std::vector<unsigned int>& visible, ThreadPool* pool) const
+{
+    if (staleBvh)
+    {
+        cull(frustum, visible, pool);
+        return;
+    }
+    visible.clear();
+    if (bvhNodes.empty())
+        return;
+    if (!pool)
+    {
+        cullNode(frustum, 0, visible);
+        return;
+    }
+
+    // Expand the top of the tree breadth-first until there is enough
+    // independent subtrees to keep every worker busy.
+    frontier.assign(1, 0);
+    size_t target = (size_t)(pool->workerCount() + 1) * 4;
+    while (frontier.size() < target)
+    {
+        next.clear();
+        bool expanded = false;
+        for (unsigned int node : frontier)
+        {
+            if (bvhNodes[node].itemCount > 0)
+            {
+                next.push_back(node);
+                continue;
+            }
+            next.push_back(bvhNodes[node].first);
+            next.push_back(bvhNodes[node].second);
+            expanded = true;
+        }
+        frontier.swap(next);
+        if (!expanded)
+            break;
+    }
+
+    FrameVector<FrameVector<unsigned int>> partial(frontier.size());
+    pool->parallelFor(frontier.size(), [&](size_t begin, size_t end)
+    {
+        for (size_t f = begin; f < end; ++f)
+            cullNode(frustum, frontier[f], partial[f]);
+    });
+    for (const FrameVector<unsigned int>& part : partial)
+        visible.insert(visible.end(), part.begin(), part.end());
+}
@@ -0,0 +1,76 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include "ThreadPool.h"
+#include <cstddef>
+#include <vector>
+
+// Planes are (a, b, c, d) with a point inside when a*x + b*y + c*z + d >= 0.
+struct Frustum
+{
+    float planes[6][4];
+};
+
+// viewProjection is column-major, as passed to glUniformMatrix4fv.
+Frustum extractFrustum(const float* viewProjection);
+// Orthographic 2D viewport; the near/far planes accept everything.
+Frustum viewportFrustum2D(float left, float right, float bottom, float top);
+
+// Instance bounds kept as SoA centers and half-extents so one SIMD register
+// holds the same component for 8 (AVX2) or 4 (SSE2) boxes.
+class CullingSystem
+{
+public:
+    unsigned int add(const float boundsMin[3], const float boundsMax[3]);
+    void update(unsigned int id, const float boundsMin[3], const float boundsMax[3]);
+    void clear();
+    size_t size() const { return count; }
+    void bounds(unsigned int id, float boundsMin[3], float boundsMax[3]) const;
+
+    // Tests every box; with a pool the work is split into ranges per worker.
+    void cull(const Frustum& frustum, std::vector<unsigned int>& visible, ThreadPool* pool = nullptr) const;
+
+    // BVH for large, mostly static sets. update() on a built hierarchy marks
+    // the leaf dirty and refitBvh() only walks dirty paths up to the root.
+    // add() marks the hierarchy stale; cullBvh() then tests every box with
+    // cull() until buildBvh() runs again.
+    void buildBvh(unsigned int leafSize = 8);
+    void refitBvh();
+    void cullBvh(const Frustum& frustum, std::vector<unsigned int>& visible, ThreadPool* pool = nullptr) const;
+    bool bvhStale() const { return staleBvh; }
+
+private:
+    struct BvhNode
+    {
+        float boundsMin[3];
+        float boundsMax[3];
+        unsigned int first;      // leaf: offset into bvhItems; inner: left child
+        unsigned int second;     // inner: right child
+        unsigned int itemCount;  // 0 for inner nodes
+        unsigned int parent;
+    };
+
+    // Writes visible ids to out, which must hold end - begin entries.
+    size_t cullRange(const Frustum& frustum, size_t begin, size_t end, unsigned int* out) const;
+    unsigned int buildNode(unsigned int parent, unsigned int first, unsigned int itemCount, unsigned int leafSize);
+    void refitNode(unsigned int node);
+    template <typename Container>
+    void cullNode(const Frustum& frustum, unsigned int node, Container& visible) const;
+
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    size_t count = 0;
+
+    std::vector<BvhNode> bvhNodes;
+    std::vector<unsigned int> bvhItems;
+    std::vector<unsigned int> itemLeaf;
+    std::vector<unsigned int> dirtyLeaves;
+    bool staleBvh = true;
+
+    // Scratch for cullBvh() kept across frames so a steady state allocates
+    // nothing; cullBvh() is therefore not safe to call concurrently.
+    mutable std::vector<unsigned int> frontier;
+    mutable std::vector<unsigned int> next;
+};
+
+#endif
@@ -0,0 +1,273 @@
+#include "DecodePool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    // Powers of two up to 1 MB, then four classes per doubling so a large
+    // decode output wastes at most a fifth of its block.
+    const int MinClassBits = 6;      // 64 bytes
+    const int FineClassBits = 20;    // 1 MB
+    const int MaxClassBits = 26;     // 64 MB
+    const int StepsPerDoubling = 4;
+    const int CoarseClassCount = FineClassBits - MinClassBits + 1;
+    const int ClassCount = CoarseClassCount + (MaxClassBits - FineClassBits) * StepsPerDoubling;
+    const unsigned int Unpooled = 0xFF;
+    const size_t MaxCachedBytes = (size_t)96 << 20;    // all threads together
+
+    // Keeps the payload 16-byte aligned, like malloc on x64.
+    struct BlockHeader
+    {
+        size_t capacity;
+        unsigned int sizeClass;
+        unsigned int padding;
+    };
+    static_assert(sizeof(BlockHeader) == 16, "header must preserve alignment");
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    std::atomic<size_t> allocationCount{ 0 };
+    std::atomic<size_t> reuseCount{ 0 };
+    std::atomic<size_t> systemCount{ 0 };
+    std::atomic<size_t> freeCount{ 0 };
+    std::atomic<size_t> cachedTotal{ 0 };
+
+    // Small classes are cheap to hold on to; large ones are decode outputs,
+    // of which a thread rarely needs more than a couple at once.
+    int classLimit(int sizeClass)
+    {
+        return sizeClass + MinClassBits <= 16 ? 32 : 4;
+    }
+
+    size_t classCapacity(int sizeClass)
+    {
+        if (sizeClass < CoarseClassCount)
+            return (size_t)1 << (sizeClass + MinClassBits);
+        int fine = sizeClass - CoarseClassCount;
+        int bits = FineClassBits + fine / StepsPerDoubling;
+        size_t step = (size_t)1 << (bits - 2);
+        return ((size_t)1 << bits) + step * (fine % StepsPerDoubling + 1);
+    }
+
+    int sizeClassFor(size_t size)
+    {
+        if (size <= ((size_t)1 << FineClassBits))
+        {
+            int bits = MinClassBits;
+            while (((size_t)1 << bits) < size)
+                ++bits;
+            return bits - MinClassBits;
+        }
+        if (size > ((size_t)1 << MaxClassBits))
+            return -1;
+        int bits = FineClassBits;
+        while (((size_t)1 << (bits + 1)) < size)
+            ++bits;
+        size_t step = (size_t)1 << (bits - 2);
+        size_t steps = (size - ((size_t)1 << bits) + step - 1) / step;
+        return CoarseClassCount + (bits - FineClassBits) * StepsPerDoubling + (int)steps - 1;
+    }
+
+    // The owning thread takes the lock around every list operation; it is
+    // only ever contended by trimAllDecodePools().
+    struct ThreadCache
+    {
+        std::mutex mutex;
+        FreeBlock* heads[ClassCount] = {};
+        int counts[ClassCount] = {};
+        size_t bytes = 0;
+
+        void trim()
+        {
+            for (int c = 0; c < ClassCount; ++c)
+            {
+                while (heads[c])
+                {
+                    FreeBlock* block = heads[c];
+                    heads[c] = block->next;
+                    free((BlockHeader*)block - 1);
+                }
+                counts[c] = 0;
+            }
+            cachedTotal -= bytes;
+            bytes = 0;
+        }
+    };
+
+    // The flag is trivially destructible, so frees that arrive after the
+    // cache is gone (static destructors at thread exit) can still check it
+    // and fall back to free().
+    thread_local bool cacheDestroyed = false;
+
+    // Every live thread cache, for trimAllDecodePools(). Never destroyed:
+    // pool workers can exit after static destructors have run, and their
+    // caches still unregister themselves.
+    std::mutex& registryMutex()
+    {
+        static std::mutex* mutex = new std::mutex;
+        return *mutex;
+    }
+
+    std::vector<ThreadCache*>& registry()
+    {
+        static std::vector<ThreadCache*>* caches = new std::vector<ThreadCache*>;
+        return *caches;
+    }
+
+    struct ThreadCacheHolder
+    {
+        ThreadCache cache;
+        ThreadCacheHolder()
+        {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            registry().push_back(&cache);
+        }
+        ~ThreadCacheHolder()
+        {
+            cacheDestroyed = true;
+            {
+                std::lock_guard<std::mutex> lock(registryMutex());
+                std::vector<ThreadCache*>& caches = registry();
+                caches.erase(std::find(caches.begin(), caches.end(), &cache));
+            }
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            cache.trim();
+        }
+    };
+
+    ThreadCache* threadCache()
+    {
+        if (cacheDestroyed)
+            return nullptr;
+        thread_local ThreadCacheHolder holder;
+        return &holder.cache;
+    }
+
+    void* systemAllocate(size_t capacity, unsigned int sizeClass)
+    {
+        BlockHeader* header = (BlockHeader*)malloc(sizeof(BlockHeader) + capacity);
+        if (!header)
+            return nullptr;
+        ++systemCount;
+        header->capacity = capacity;
+        header->sizeClass = sizeClass;
+        return header + 1;
+    }
+}
+
+void* decodeAllocate(size_t size)
+{
+    ++allocationCount;
+    int sizeClass = sizeClassFor(size);
+    if (sizeClass < 0)
+        return systemAllocate(size, Unpooled);
+
+    size_t capacity = classCapacity(sizeClass);
+    if (ThreadCache* cache = threadCache())
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        if (FreeBlock* block = cache->heads[sizeClass])
+        {
+            cache->heads[sizeClass] = block->next;
+            --cache->counts[sizeClass];
+            cache->bytes -= capacity;
+            cachedTotal -= capacity;
+            ++reuseCount;
+            return block;
+        }
+    }
+    return systemAllocate(capacity, (unsigned int)sizeClass);
+}
+
+void decodeFree(void* pointer)
+{
+    if (!pointer)
+        return;
+    ++freeCount;
+    BlockHeader* header = (BlockHeader*)pointer - 1;
+    ThreadCache* cache = threadCache();
+    unsigned int sizeClass = header->sizeClass;
+    if (sizeClass == Unpooled || !cache)
+    {
+        free(header);
+        return;
+    }
+
+    // Reserve room under the process-wide cap before caching the block.
+    size_t capacity = header->capacity;
+    if (cachedTotal.fetch_add(capacity) + capacity > MaxCachedBytes)
+    {
+        cachedTotal -= capacity;
+        free(header);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    if (cache->counts[sizeClass] >= classLimit((int)sizeClass))
+    {
+        cachedTotal -= capacity;
+        free(header);
+        return;
+    }
+    FreeBlock* block = (FreeBlock*)pointer;
+    block->next = cache->heads[sizeClass];
+    cache->heads[sizeClass] = block;
+    ++cache->counts[sizeClass];
+    cache->bytes += capacity;
+}
+
+void* decodeReallocate(void* pointer, size_t size)
+{
+    if (!pointer)
+        return decodeAllocate(size);
+
+    // Classes leave headroom, so most of stb's growing reallocs (zlib
+    // output, PNG chunks) stay in place.
+    BlockHeader* header = (BlockHeader*)pointer - 1;
+    if (size <= header->capacity)
+        return pointer;
+
+    void* grown = decodeAllocate(size);
+    if (!grown)
+        return nullptr;
+    memcpy(grown, pointer, header->capacity);
+    decodeFree(pointer);
+    return grown;
+}
+
+void trimDecodePool()
+{
+    if (ThreadCache* cache = threadCache())
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        cache->trim();
+    }
+}
+
+void trimAllDecodePools()
+{
+    std::lock_guard<std::mutex> registryLock(registryMutex());
+    for (ThreadCache* cache : registry())
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        cache->trim();
+    }
+}
+
+DecodePoolStats decodePoolStats()
+{
+    DecodePoolStats stats;
+    stats.allocations = allocationCount.load();
+    stats.reused = reuseCount.load();
+    stats.systemAllocations = systemCount.load();
+    stats.frees = freeCount.load();
+    stats.cachedBytes = cachedTotal.load();
+    return stats;
+}
@@ -0,0 +1,34 @@
+#ifndef DECODE_POOL_H
+#define DECODE_POOL_H
+
+#include <cstddef>
+
+struct DecodePoolStats
+{
+    size_t allocations;          // every allocate and growing reallocate
+    size_t reused;               // served from a thread's free lists
+    size_t systemAllocations;    // fell through to malloc
+    size_t frees;
+    size_t cachedBytes;          // held in free lists, all threads
+};
+
+// Allocator behind stb_image's STBI_MALLOC/STBI_REALLOC/STBI_FREE. Sizes
+// round up to power-of-two classes below 1 MB and quarter steps above, and
+// freed blocks go on a free list of the freeing thread, so the decoder's
+// temporaries and the output buffers of one load are recycled by the next.
+// Each list has its own lock, uncontended outside trimAllDecodePools().
+// Each thread caches at most a few blocks per class, and all threads
+// together at most 96 MB; anything larger than the biggest class (64 MB)
+// goes straight to malloc.
+void* decodeAllocate(size_t size);
+void* decodeReallocate(void* pointer, size_t size);
+void decodeFree(void* pointer);
+
+// Returns the calling thread's cached blocks to the system.
+void trimDecodePool();
+// Same for every thread's cache, e.g. after a level has finished loading.
+void trimAllDecodePools();
+
+DecodePoolStats decodePoolStats();
+
+#endif
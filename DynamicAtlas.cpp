@@ -0,0 +1,351 @@
+#include "DynamicAtlas.h"
+#include "GpuMemory.h"
+#include <algorithm>
+#include <cstring>
+
+SkylinePacker::SkylinePacker(int packerWidth, int packerHeight)
+{
+    reset(packerWidth, packerHeight);
+}
+
+void SkylinePacker::reset(int packerWidth, int packerHeight)
+{
+    width = packerWidth;
+    height = packerHeight;
+    skyline.clear();
+    Segment floor = { 0, 0, packerWidth };
+    skyline.push_back(floor);
+}
+
+int SkylinePacker::fit(size_t index, int rectWidth, int rectHeight) const
+{
+    int x = skyline[index].x;
+    if (x + rectWidth > width)
+        return -1;
+
+    int y = skyline[index].y;
+    int remaining = rectWidth;
+    for (size_t i = index; remaining > 0; ++i)
+    {
+        y = std::max(y, skyline[i].y);
+        if (y + rectHeight > height)
+            return -1;
+        remaining -= skyline[i].width;
+    }
+    return y;
+}
+
+bool SkylinePacker::insert(int rectWidth, int rectHeight, int& x, int& y)
+{
+    size_t best = skyline.size();
+    int bestTop = height + 1;
+    for (size_t i = 0; i < skyline.size(); ++i)
+    {
+        int top = fit(i, rectWidth, rectHeight);
+        if (top >= 0 && top + rectHeight < bestTop)
+        {
+            best = i;
+            bestTop = top + rectHeight;
+        }
+    }
+    if (best == skyline.size())
+        return false;
+
+    x = skyline[best].x;
+    y = bestTop - rectHeight;
+    Segment placed = { x, bestTop, rectWidth };
+    skyline.insert(skyline.begin() + best, placed);
+
+    // Trim the segments now covered by the new one.
+    for (size_t i = best + 1; i < skyline.size(); )
+    {
+        int end = skyline[i - 1].x + skyline[i - 1].width;
+        if (skyline[i].x >= end)
+            break;
+        int shrink = end - skyline[i].x;
+        skyline[i].x += shrink;
+        skyline[i].width -= shrink;
+        if (skyline[i].width > 0)
+            break;
+        skyline.erase(skyline.begin() + i);
+    }
+
+    for (size_t i = 0; i + 1 < skyline.size(); )
+    {
+        if (skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    return true;
+}
+
+DynamicAtlas::DynamicAtlas(int size, int pageLimit, int channelCount, int gap)
+    : pageSize(size), maxPages(std::max(pageLimit, 1)), channels(channelCount == 1 ? 1 : 4), padding(std::max(gap, 0)),
+      format(channelCount == 1 ? GL_RED : GL_RGBA)
+{
+}
+
+unsigned int DynamicAtlas::addPage()
+{
+    pages.emplace_back();
+    Page& page = pages.back();
+    page.packer.reset(pageSize, pageSize);
+    page.pixels.assign((size_t)pageSize * pageSize * channels, 0);
+    page.texture = TextureObject::create();
+
+    glBindTexture(GL_TEXTURE_2D, page.texture.id());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, channels == 1 ? GL_R8 : GL_RGBA8, pageSize, pageSize, 0, format, GL_UNSIGNED_BYTE,
+        page.pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    GpuMemory::shared().record(GpuTexture, page.texture.id(), GpuMemoryTextures, textureMemorySize(pageSize, pageSize, format, false));
+    return (unsigned int)pages.size() - 1;
+}
+
+void DynamicAtlas::setRegion(Entry& entry, unsigned int page)
+{
+    entry.region.page = page;
+    entry.region.uvMin[0] = (float)entry.x / pageSize;
+    entry.region.uvMin[1] = (float)entry.y / pageSize;
+    entry.region.uvMax[0] = (float)(entry.x + entry.width) / pageSize;
+    entry.region.uvMax[1] = (float)(entry.y + entry.height) / pageSize;
+}
+
+bool DynamicAtlas::place(unsigned int pageIndex, Entry& entry, const unsigned char* pixels)
+{
+    Page& page = pages[pageIndex];
+    int x, y;
+    if (!page.packer.insert(entry.width + padding, entry.height + padding, x, y))
+        return false;
+
+    entry.x = x;
+    entry.y = y;
+    size_t rowBytes = (size_t)entry.width * channels;
+    for (int row = 0; row < entry.height; ++row)
+        memcpy(&page.pixels[((size_t)(y + row) * pageSize + x) * channels], pixels + row * rowBytes, rowBytes);
+
+    glBindTexture(GL_TEXTURE_2D, page.texture.id());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, entry.width, entry.height, format, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    size_t area = (size_t)(entry.width + padding) * (entry.height + padding);
+    page.liveArea += area;
+    page.usedArea += area;
+    page.lastUsed = std::max(page.lastUsed, entry.lastUsed);
+    counters.uploadedBytes += (size_t)entry.height * rowBytes;
+    setRegion(entry, pageIndex);
+    return true;
+}
+
+const AtlasRegion* DynamicAtlas::find(unsigned long long key)
+{
+    counters.lookups += 1;
+    std::unordered_map<unsigned long long, Entry>::iterator it = entries.find(key);
+    if (it == entries.end())
+    {
+        counters.misses += 1;
+        return NULL;
+    }
+    it->second.lastUsed = frame;
+    pages[it->second.region.page].lastUsed = frame;
+    lru.splice(lru.begin(), lru, it->second.lru);
+    return &it->second.region;
+}
+
+const AtlasRegion* DynamicAtlas::insert(unsigned long long key, const unsigned char* pixels, int width, int height)
+{
+    std::unordered_map<unsigned long long, Entry>::iterator existing = entries.find(key);
+    if (existing != entries.end())
+        return find(key);
+    if (width + padding > pageSize || height + padding > pageSize)
+        return NULL;
+
+    Entry entry = {};
+    entry.width = width;
+    entry.height = height;
+    entry.lastUsed = frame;
+
+    bool placed = false;
+    for (unsigned int page = 0; page < pages.size() && !placed; ++page)
+        placed = place(page, entry, pixels);
+    if (!placed && (int)pages.size() < maxPages)
+        placed = place(addPage(), entry, pixels);
+
+    // Evict from the cold end until a page has room once compacted. Free
+    // an eighth of a page while at it, so the inserts that follow do not
+    // each pay for a compaction. Pages with an entry used this frame are
+    // never compacted here, since their regions may already be in use.
+    size_t needed = (size_t)(width + padding) * (height + padding);
+    size_t slack = std::max(needed, (size_t)pageSize * pageSize / 8);
+    bool anyCold = false;
+    for (const Page& page : pages)
+        anyCold = anyCold || page.lastUsed < frame;
+    while (!placed && anyCold)
+    {
+        bool canEvict = !lru.empty() && entries[lru.back()].lastUsed < frame;
+        if (canEvict)
+        {
+            evict(lru.back());
+            counters.evictions += 1;
+        }
+
+        unsigned int roomiest = ~0u;
+        for (unsigned int page = 0; page < pages.size(); ++page)
+        {
+            if (pages[page].lastUsed < frame && (roomiest == ~0u || pages[page].liveArea < pages[roomiest].liveArea))
+                roomiest = page;
+        }
+        size_t room = (size_t)pageSize * pageSize - pages[roomiest].liveArea;
+        bool moreToEvict = !lru.empty() && entries[lru.back()].lastUsed < frame;
+        // compact() leaves a page it cannot repack as it was; then keep
+        // evicting, or fail the insert once nothing cold is left.
+        if (room >= needed && (room >= slack || !moreToEvict) && compact(roomiest))
+            placed = place(roomiest, entry, pixels);
+        if (!placed && !moreToEvict)
+            break;
+    }
+    if (!placed)
+        return NULL;
+
+    counters.inserts += 1;
+    lru.push_front(key);
+    entry.lru = lru.begin();
+    return &entries.emplace(key, entry).first->second.region;
+}
+
+void DynamicAtlas::evict(unsigned long long key)
+{
+    std::unordered_map<unsigned long long, Entry>::iterator it = entries.find(key);
+    if (it == entries.end())
+        return;
+    const Entry& entry = it->second;
+    pages[entry.region.page].liveArea -= (size_t)(entry.width + padding) * (entry.height + padding);
+    lru.erase(entry.lru);
+    entries.erase(it);
+}
+
+void DynamicAtlas::remove(unsigned long long key)
+{
+    evict(key);
+}
+
+// Returns false, leaving the page as it was, if an entry used this frame
+// would not fit the new packing; cold entries that do not fit are evicted.
+bool DynamicAtlas::compact(unsigned int pageIndex)
+{
+    Page& page = pages[pageIndex];
+    std::vector<Entry*> live;
+    std::vector<unsigned long long> keys;
+    for (std::pair<const unsigned long long, Entry>& item : entries)
+    {
+        if (item.second.region.page == pageIndex)
+        {
+            live.push_back(&item.second);
+            keys.push_back(item.first);
+        }
+    }
+
+    std::vector<size_t> order(live.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return live[a]->height > live[b]->height; });
+
+    // Repack tallest first into a fresh skyline before touching anything.
+    SkylinePacker packer(pageSize, pageSize);
+    std::vector<int> newX(live.size(), -1), newY(live.size(), -1);
+    for (size_t i : order)
+    {
+        Entry& entry = *live[i];
+        if (packer.insert(entry.width + padding, entry.height + padding, newX[i], newY[i]))
+            continue;
+        // A different order can occasionally pack worse.
+        if (entry.lastUsed == frame)
+            return false;
+        newX[i] = -1;
+    }
+
+    // Move texels on the CPU copy, then upload the page once.
+    std::vector<unsigned char> pixels((size_t)pageSize * pageSize * channels, 0);
+    page.packer = packer;
+    page.liveArea = 0;
+    for (size_t i = 0; i < live.size(); ++i)
+    {
+        Entry& entry = *live[i];
+        if (newX[i] < 0)
+            continue;
+        size_t rowBytes = (size_t)entry.width * channels;
+        for (int row = 0; row < entry.height; ++row)
+        {
+            memcpy(&pixels[((size_t)(newY[i] + row) * pageSize + newX[i]) * channels],
+                &page.pixels[((size_t)(entry.y + row) * pageSize + entry.x) * channels], rowBytes);
+        }
+        entry.x = newX[i];
+        entry.y = newY[i];
+        setRegion(entry, pageIndex);
+        page.liveArea += (size_t)(entry.width + padding) * (entry.height + padding);
+    }
+    page.pixels.swap(pixels);
+    page.usedArea = page.liveArea;
+
+    for (size_t i = 0; i < live.size(); ++i)
+    {
+        if (newX[i] >= 0)
+            continue;
+        lru.erase(live[i]->lru);
+        entries.erase(keys[i]);
+        counters.evictions += 1;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, page.texture.id());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pageSize, pageSize, format, GL_UNSIGNED_BYTE, page.pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    counters.uploadedBytes += page.pixels.size();
+    counters.compactions += 1;
+    moves += 1;
+    return true;
+}
+
+void DynamicAtlas::update()
+{
+    // Compact at most one page per frame, the most fragmented one, once a
+    // quarter of it is dead space.
+    size_t threshold = (size_t)pageSize * pageSize / 4;
+    unsigned int worst = 0;
+    size_t worstDead = 0;
+    for (unsigned int page = 0; page < pages.size(); ++page)
+    {
+        size_t dead = pages[page].usedArea - pages[page].liveArea;
+        if (dead > worstDead)
+        {
+            worst = page;
+            worstDead = dead;
+        }
+    }
+    if (worstDead >= threshold)
+        compact(worst);
+    ++frame;
+}
+
+AtlasStats DynamicAtlas::stats() const
+{
+    AtlasStats result = counters;
+    result.entries = entries.size();
+    result.pages = pages.size();
+    size_t live = 0;
+    for (const Page& page : pages)
+        live += page.liveArea;
+    result.occupancy = pages.empty() ? 0.0f : (float)live / ((float)pageSize * pageSize * pages.size());
+    return result;
+}
@@ -0,0 +1,133 @@
+#ifndef DYNAMIC_ATLAS_H
+#define DYNAMIC_ATLAS_H
+
+#include <glad/glad.h>
+#include "GpuResources.h"
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// Bottom-left skyline rectangle packer. The skyline is the list of
+// horizontal segments forming the top edge of everything placed so far.
+class SkylinePacker
+{
+public:
+    SkylinePacker(int width = 0, int height = 0);
+
+    void reset(int width, int height);
+    bool insert(int width, int height, int& x, int& y);
+
+private:
+    struct Segment
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    // Height at which a rect of the given width rests when placed at
+    // segment index, or -1 if it does not fit there.
+    int fit(size_t index, int width, int height) const;
+
+    std::vector<Segment> skyline;
+    int width;
+    int height;
+};
+
+struct AtlasRegion
+{
+    unsigned int page;
+    float uvMin[2];
+    float uvMax[2];
+};
+
+struct AtlasStats
+{
+    size_t lookups;
+    size_t misses;
+    size_t inserts;
+    size_t evictions;
+    size_t compactions;
+    size_t uploadedBytes;
+    size_t entries;
+    size_t pages;
+    float occupancy;    // live texels / page texels
+};
+
+// Atlas for images that arrive at runtime (thumbnails, glyphs). Entries
+// are packed into fixed-size pages with a skyline packer and only their
+// rectangle is uploaded. When every page is full the least recently used
+// entries are evicted and the page they free is compacted. update()
+// compacts one fragmented page per frame so space freed by eviction is
+// reclaimed gradually. Each page keeps a CPU copy for compaction.
+//
+// Within a frame, regions returned by find() and insert() stay put: insert()
+// only compacts pages with no entry used this frame. update() may move any
+// entry, so UVs kept across frames must be refreshed with find() whenever
+// generation() changes. Evicted entries' regions are gone for good.
+class DynamicAtlas
+{
+public:
+    // channels is 1 (GL_RED) or 4 (GL_RGBA); every image must match.
+    DynamicAtlas(int pageSize = 1024, int maxPages = 4, int channels = 4, int padding = 1);
+
+    // O(1); marks the entry used this frame. Returns NULL if key is absent.
+    const AtlasRegion* find(unsigned long long key);
+
+    // Adds pixels under key, or returns the existing region if key is
+    // already present. Returns NULL if the image cannot fit even after
+    // evicting everything not used this frame.
+    const AtlasRegion* insert(unsigned long long key, const unsigned char* pixels, int width, int height);
+    void remove(unsigned long long key);
+
+    void update();
+
+    // Bumped whenever compaction moves entries.
+    unsigned int generation() const { return moves; }
+
+    unsigned int pageTexture(unsigned int page) const { return pages[page].texture.id(); }
+    size_t pageCount() const { return pages.size(); }
+    AtlasStats stats() const;
+
+private:
+    struct Entry
+    {
+        AtlasRegion region;
+        int x;
+        int y;
+        int width;
+        int height;
+        unsigned long long lastUsed;
+        std::list<unsigned long long>::iterator lru;
+    };
+
+    struct Page
+    {
+        TextureObject texture;
+        SkylinePacker packer;
+        std::vector<unsigned char> pixels;
+        size_t liveArea = 0;
+        size_t usedArea = 0;    // live plus dead, as seen by the packer
+        unsigned long long lastUsed = 0;    // latest lastUsed of its entries
+    };
+
+    bool place(unsigned int page, Entry& entry, const unsigned char* pixels);
+    void setRegion(Entry& entry, unsigned int page);
+    void evict(unsigned long long key);
+    bool compact(unsigned int page);
+    unsigned int addPage();
+
+    int pageSize;
+    int maxPages;
+    int channels;
+    int padding;
+    GLenum format;
+    std::vector<Page> pages;
+    std::unordered_map<unsigned long long, Entry> entries;
+    std::list<unsigned long long> lru;    // most recently used first
+    unsigned long long frame = 1;
+    unsigned int moves = 0;
+    AtlasStats counters = {};
+};
+
+#endif
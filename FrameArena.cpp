@@ -0,0 +1,120 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <cstdint>
+
+LinearArena::LinearArena(size_t size)
+    : blockSize(size)
+{
+}
+
+void* LinearArena::allocate(size_t size, size_t alignment)
+{
+    for (;;)
+    {
+        if (currentBlock < blocks.size())
+        {
+            Block& block = blocks[currentBlock];
+            uintptr_t base = (uintptr_t)block.memory.get();
+            uintptr_t aligned = (base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+            size_t end = (size_t)(aligned - base) + size;
+            if (end <= block.size)
+            {
+                used += end - offset;
+                offset = end;
+                highWater = std::max(highWater, used);
+                return (void*)aligned;
+            }
+            // Skip to the next retained block, if any.
+            if (currentBlock + 1 < blocks.size())
+            {
+                used += block.size - offset;
+                ++currentBlock;
+                offset = 0;
+                continue;
+            }
+        }
+
+        // Only reached while warming up or when a frame outgrows every
+        // previous one.
+        Block block;
+        block.size = std::max(blockSize, size + alignment);
+        block.memory.reset(new unsigned char[block.size]);
+        reserved += block.size;
+        if (currentBlock < blocks.size())
+            used += blocks[currentBlock].size - offset;
+        blocks.push_back(std::move(block));
+        currentBlock = blocks.size() - 1;
+        offset = 0;
+    }
+}
+
+void LinearArena::reset()
+{
+    currentBlock = 0;
+    offset = 0;
+    used = 0;
+}
+
+FrameArena::FrameArena(size_t blockSize, unsigned int frames, unsigned int threads)
+    : framesInFlight(std::max(frames, 1u)), maxThreads(std::max(threads, 1u))
+{
+    arenas.reserve((size_t)framesInFlight * maxThreads);
+    for (size_t i = 0; i < (size_t)framesInFlight * maxThreads; ++i)
+        arenas.emplace_back(blockSize);
+    for (unsigned int i = 0; i < framesInFlight; ++i)
+        overflow.emplace_back(blockSize);
+}
+
+static std::atomic<unsigned int> nextThreadSlot(0);
+
+static unsigned int threadSlot()
+{
+    thread_local unsigned int slot = nextThreadSlot.fetch_add(1);
+    return slot;
+}
+
+LinearArena& FrameArena::threadArena()
+{
+    return arenas[(size_t)frame * maxThreads + threadSlot()];
+}
+
+void FrameArena::beginFrame()
+{
+    FrameArenaStats current = stats();
+    frameHighWater = std::max(frameHighWater, current.bytesUsed);
+
+    frame = (frame + 1) % framesInFlight;
+    for (unsigned int slot = 0; slot < maxThreads; ++slot)
+        arenas[(size_t)frame * maxThreads + slot].reset();
+    overflow[frame].reset();
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+    if (threadSlot() < maxThreads)
+        return threadArena().allocate(size, alignment);
+
+    std::lock_guard<std::mutex> lock(overflowMutex);
+    return overflow[frame].allocate(size, alignment);
+}
+
+FrameArenaStats FrameArena::stats() const
+{
+    FrameArenaStats result = {};
+    for (unsigned int slot = 0; slot < maxThreads; ++slot)
+        result.bytesUsed += arenas[(size_t)frame * maxThreads + slot].bytesUsed();
+    result.bytesUsed += overflow[frame].bytesUsed();
+    for (const LinearArena& arena : arenas)
+        result.bytesReserved += arena.bytesReserved();
+    for (const LinearArena& arena : overflow)
+        result.bytesReserved += arena.bytesReserved();
+    result.highWaterMark = std::max(frameHighWater, result.bytesUsed);
+    result.threadsSeen = nextThreadSlot.load();
+    return result;
+}
+
+FrameArena& FrameArena::shared()
+{
+    static FrameArena arena;
+    return arena;
+}
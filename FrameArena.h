@@ -0,0 +1,107 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Bump allocator over large blocks. reset() only rewinds the cursor; blocks
+// stay allocated so a warmed-up arena never touches the heap again.
+class LinearArena
+{
+public:
+    explicit LinearArena(size_t blockSize = 1 << 20);
+
+    void* allocate(size_t size, size_t alignment);
+    void reset();
+
+    size_t bytesUsed() const { return used; }
+    size_t bytesReserved() const { return reserved; }
+    size_t highWaterMark() const { return highWater; }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<unsigned char[]> memory;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t currentBlock = 0;
+    size_t offset = 0;
+    size_t used = 0;
+    size_t reserved = 0;
+    size_t highWater = 0;
+};
+
+struct FrameArenaStats
+{
+    size_t bytesUsed;        // current frame, all threads
+    size_t bytesReserved;    // every frame and thread
+    size_t highWaterMark;    // largest single frame seen so far
+    unsigned int threadsSeen;
+};
+
+// Per-frame scratch memory. Each frame in flight owns one LinearArena per
+// thread, so allocation takes no lock; beginFrame() moves to the next
+// frame and resets its arenas in O(1). Memory handed out during frame N
+// stays valid until beginFrame() comes back round to N.
+class FrameArena
+{
+public:
+    FrameArena(size_t blockSize = 1 << 20, unsigned int framesInFlight = 2, unsigned int maxThreads = 64);
+
+    void beginFrame();
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T* allocateArray(size_t count)
+    {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    FrameArenaStats stats() const;
+
+    static FrameArena& shared();
+
+private:
+    LinearArena& threadArena();
+
+    unsigned int framesInFlight;
+    unsigned int maxThreads;
+    unsigned int frame = 0;
+    size_t frameHighWater = 0;
+    std::vector<LinearArena> arenas;      // [frame * maxThreads + slot]
+    std::vector<LinearArena> overflow;    // per frame, for threads past maxThreads
+    std::mutex overflowMutex;
+};
+
+// std::allocator replacement drawing from FrameArena::shared(). Freeing is a
+// no-op, so reserve() up front rather than letting containers grow.
+template <typename T>
+class FrameAllocator
+{
+public:
+    typedef T value_type;
+
+    FrameAllocator() = default;
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U>&) {}
+
+    T* allocate(size_t count) { return FrameArena::shared().allocateArray<T>(count); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const FrameAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const FrameAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif
@@ -0,0 +1,121 @@
+#include "GpuCuller.h"
+#include "GpuMemory.h"
+#include <vector>
+
+GpuCuller::GpuCuller(size_t maxInstances)
+    : cullShader("3.3.cull.vs", NULL, "3.3.cull.gs", std::vector<const char*>{ "outOffsetScale" }),
+      capacity(maxInstances)
+{
+    size_t bytes = capacity * 4 * sizeof(float);
+
+    sourceVAO = VertexArrayObject::create();
+    sourceVBO = BufferObject::create();
+    glBindVertexArray(sourceVAO.id());
+    glBindBuffer(GL_ARRAY_BUFFER, sourceVBO.id());
+    glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_DYNAMIC_DRAW);
+    GpuMemory::shared().record(GpuBuffer, sourceVBO.id(), GpuMemoryCulling, bytes);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        outputVBO[i] = BufferObject::create();
+        glBindBuffer(GL_ARRAY_BUFFER, outputVBO[i].id());
+        glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_DYNAMIC_COPY);
+        GpuMemory::shared().record(GpuBuffer, outputVBO[i].id(), GpuMemoryCulling, bytes);
+    }
+    glGenQueries(2, queries);
+    frustumPlanesLocation = glGetUniformLocation(cullShader.id(), "frustumPlanes");
+}
+
+GpuCuller::~GpuCuller()
+{
+    glDeleteQueries(2, queries);
+}
+
+void GpuCuller::setInstances(const float* offsetScale, size_t count)
+{
+    instanceCount = count < capacity ? count : capacity;
+    glBindBuffer(GL_ARRAY_BUFFER, sourceVBO.id());
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instanceCount * 4 * sizeof(float), offsetScale);
+}
+
+void GpuCuller::cull(const Frustum& frustum, float boundingRadius)
+{
+    current ^= 1;
+
+    cullShader.use();
+    glUniform4fv(frustumPlanesLocation, 6, &frustum.planes[0][0]);
+    cullShader.setFloat("boundingRadius", boundingRadius);
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(sourceVAO.id());
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, outputVBO[current].id());
+    glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, queries[current]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)instanceCount);
+    glEndTransformFeedback();
+    glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(0);
+
+    queryIssued[current] = true;
+}
+
+void GpuCuller::setMesh(const PrimitiveBuffers& buffers)
+{
+    mesh = buffers;
+    for (int i = 0; i < 2; ++i)
+    {
+        drawVAO[i] = VertexArrayObject::create();
+        glBindVertexArray(drawVAO[i].id());
+        glBindBuffer(GL_ARRAY_BUFFER, buffers.VBO);
+        setupVertexAttributes(buffers.format);
+        if (buffers.useEBO)
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.EBO);
+        glBindBuffer(GL_ARRAY_BUFFER, outputVBO[i].id());
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+        glVertexAttribDivisor(3, 1);
+        glEnableVertexAttribArray(3);
+    }
+    glBindVertexArray(0);
+}
+
+void GpuCuller::draw()
+{
+    // Use the newest result the GPU already has: this frame's, else the
+    // previous frame's, whose buffer has not been overwritten since.
+    int source = -1;
+    for (int i = 0; i < 2 && source < 0; ++i)
+    {
+        int candidate = current ^ i;
+        GLuint available = 0;
+        if (queryIssued[candidate])
+            glGetQueryObjectuiv(queries[candidate], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+            source = candidate;
+    }
+    if (source >= 0)
+    {
+        glGetQueryObjectuiv(queries[source], GL_QUERY_RESULT, &lastVisible);
+    }
+    else
+    {
+        // Neither count is back: keep the last one rather than stall, with
+        // the older buffer, which is the more likely to be complete.
+        source = queryIssued[current ^ 1] ? current ^ 1 : current;
+        if (!queryIssued[source])
+            return;
+    }
+    if (lastVisible == 0 || !drawVAO[source])
+        return;
+
+    glBindVertexArray(drawVAO[source].id());
+    if (mesh.useEBO)
+        glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, mesh.indexType, 0, (GLsizei)lastVisible);
+    else
+        glDrawArraysInstanced(GL_TRIANGLES, 0, mesh.vertexCount, (GLsizei)lastVisible);
+    glBindVertexArray(0);
+}
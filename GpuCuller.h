@@ -0,0 +1,55 @@
+#ifndef GPU_CULLER_H
+#define GPU_CULLER_H
+
+#include <glad/glad.h>
+#include "Culling.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include <cstddef>
+
+// Frustum culling of instances on the GPU through transform feedback. Each
+// instance is a vec4 (xyz offset, w scale). The cull pass streams the
+// survivors into a compacted buffer and counts them with a primitive query.
+// Two output buffers alternate so draw() can use the previous frame's
+// result instead of stalling on a query that is still in flight.
+class GpuCuller
+{
+public:
+    explicit GpuCuller(size_t maxInstances);
+    ~GpuCuller();
+
+    GpuCuller(const GpuCuller&) = delete;
+    GpuCuller& operator=(const GpuCuller&) = delete;
+
+    void setInstances(const float* offsetScale, size_t count);
+    void cull(const Frustum& frustum, float boundingRadius);
+
+    // Builds the culler's own VAOs over the mesh buffers plus the instance
+    // data on attribute 3, so the mesh's VAO is never touched. Call once
+    // before draw(); buffers must outlive the culler's use of them.
+    void setMesh(const PrimitiveBuffers& buffers);
+
+    // Draws the mesh once per surviving instance; use it with
+    // 3.3.instanced.vs. Never waits on the GPU: if no cull result is ready
+    // yet, the previous count is drawn from the older buffer.
+    void draw();
+
+    GLuint visibleCount() const { return lastVisible; }
+
+private:
+    Shader cullShader;
+    GLint frustumPlanesLocation = -1;
+    size_t capacity;
+    size_t instanceCount = 0;
+    VertexArrayObject sourceVAO;
+    BufferObject sourceVBO;
+    BufferObject outputVBO[2];
+    VertexArrayObject drawVAO[2];    // mesh plus outputVBO[i] on attribute 3
+    PrimitiveBuffers mesh = {};
+    unsigned int queries[2] = {};
+    bool queryIssued[2] = {};
+    int current = 0;
+    GLuint lastVisible = 0;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "GpuMemory.h"
+#include <algorithm>
+
+void GpuMemory::record(GpuResourceType type, unsigned int glName, GpuMemoryTag tag, size_t size)
+{
+    if (glName == 0)
+        return;
+    forget(type, glName);
+
+    Record entry = { tag, size };
+    records[key(type, glName)] = entry;
+    bytes[tag] += size;
+    objects[tag] += 1;
+    total += size;
+    peak = std::max(peak, total);
+}
+
+void GpuMemory::forget(GpuResourceType type, unsigned int glName)
+{
+    std::unordered_map<unsigned long long, Record>::iterator it = records.find(key(type, glName));
+    if (it == records.end())
+        return;
+    bytes[it->second.tag] -= it->second.bytes;
+    objects[it->second.tag] -= 1;
+    total -= it->second.bytes;
+    records.erase(it);
+}
+
+GpuMemoryStats GpuMemory::stats() const
+{
+    GpuMemoryStats result = {};
+    for (int tag = 0; tag < GpuMemoryTagCount; ++tag)
+    {
+        result.bytes[tag] = bytes[tag];
+        result.objects[tag] = objects[tag];
+    }
+    result.totalBytes = total;
+    result.peakBytes = peak;
+    result.budgetBytes = budgetBytes;
+    return result;
+}
+
+const char* GpuMemory::tagName(GpuMemoryTag tag)
+{
+    switch (tag)
+    {
+    case GpuMemoryTextures: return "textures";
+    case GpuMemoryMeshes: return "meshes";
+    case GpuMemoryCulling: return "culling";
+    default: return "other";
+    }
+}
+
+GpuMemory& GpuMemory::shared()
+{
+    static GpuMemory memory;
+    return memory;
+}
+
+size_t textureMemorySize(int width, int height, GLenum format, bool mipmapped)
+{
+    size_t texelBytes = 4;
+    if (format == GL_RED || format == GL_R8)
+        texelBytes = 1;
+    else if (format == GL_RG || format == GL_RG8 || format == GL_R16)
+        texelBytes = 2;
+    else if (format == GL_RGB16 || format == GL_RGBA16 || format == GL_RGBA16F)
+        texelBytes = 8;
+
+    size_t size = 0;
+    for (;;)
+    {
+        size += (size_t)width * height * texelBytes;
+        if (!mipmapped || (width == 1 && height == 1))
+            break;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return size;
+}
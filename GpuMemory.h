@@ -0,0 +1,73 @@
+#ifndef GPU_MEMORY_H
+#define GPU_MEMORY_H
+
+#include <glad/glad.h>
+#include "GpuResources.h"
+#include <cstddef>
+#include <unordered_map>
+
+enum GpuMemoryTag
+{
+    GpuMemoryTextures,
+    GpuMemoryMeshes,
+    GpuMemoryCulling,
+    GpuMemoryOther,
+    GpuMemoryTagCount
+};
+
+struct GpuMemoryStats
+{
+    size_t bytes[GpuMemoryTagCount];
+    size_t objects[GpuMemoryTagCount];
+    size_t totalBytes;
+    size_t peakBytes;
+    size_t budgetBytes;    // 0 when unlimited
+};
+
+// Bytes allocated for every GL texture and buffer, tagged by the subsystem
+// that owns it. Callers record an object after sizing its storage (again
+// after resizing it); GpuResources forgets it as soon as it is released,
+// so the totals reflect live objects only. GL thread only.
+class GpuMemory
+{
+public:
+    void record(GpuResourceType type, unsigned int glName, GpuMemoryTag tag, size_t bytes);
+    void forget(GpuResourceType type, unsigned int glName);
+
+    void setBudget(size_t bytes) { budgetBytes = bytes; }
+    size_t budget() const { return budgetBytes; }
+    size_t totalBytes() const { return total; }
+    bool overBudget() const { return budgetBytes != 0 && total > budgetBytes; }
+
+    GpuMemoryStats stats() const;
+
+    static const char* tagName(GpuMemoryTag tag);
+    static GpuMemory& shared();
+
+private:
+    struct Record
+    {
+        GpuMemoryTag tag;
+        size_t bytes;
+    };
+
+    static unsigned long long key(GpuResourceType type, unsigned int glName)
+    {
+        return ((unsigned long long)type << 32) | glName;
+    }
+
+    std::unordered_map<unsigned long long, Record> records;
+    size_t bytes[GpuMemoryTagCount] = {};
+    size_t objects[GpuMemoryTagCount] = {};
+    size_t total = 0;
+    size_t peak = 0;
+    size_t budgetBytes = 0;
+};
+
+// Storage for a width x height image in format, with its full mip chain
+// when mipmapped. format may be a pixel format or a sized internal one.
+// Drivers pad 3-channel textures to 4, so GL_RGB counts as 4 bytes per
+// texel and GL_RGB16 as 8.
+size_t textureMemorySize(int width, int height, GLenum format, bool mipmapped);
+
+#endif
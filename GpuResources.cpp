@@ -0,0 +1,159 @@
+#include "GpuResources.h"
+#include "GpuMemory.h"
+
+unsigned int GpuResources::generate(GpuResourceType type)
+{
+    unsigned int name = 0;
+    switch (type)
+    {
+    case GpuTexture: glGenTextures(1, &name); break;
+    case GpuBuffer: glGenBuffers(1, &name); break;
+    case GpuVertexArray: glGenVertexArrays(1, &name); break;
+    case GpuProgram: name = glCreateProgram(); break;
+    case GpuFramebuffer: glGenFramebuffers(1, &name); break;
+    case GpuRenderbuffer: glGenRenderbuffers(1, &name); break;
+    default: break;
+    }
+    return name;
+}
+
+unsigned int GpuResources::allocateSlot(GpuResourceType type, unsigned int glName, unsigned int& generation)
+{
+    Pool& pool = pools[type];
+    unsigned int index;
+    if (!pool.freeSlots.empty())
+    {
+        index = pool.freeSlots.back();
+        pool.freeSlots.pop_back();
+        pool.names[index] = glName;
+    }
+    else
+    {
+        index = (unsigned int)pool.names.size();
+        pool.names.push_back(glName);
+        pool.generations.push_back(0);
+    }
+
+    // Skip 0 on wrap-around so a null handle can never match.
+    unsigned int& slotGeneration = pool.generations[index];
+    if (++slotGeneration == 0)
+        slotGeneration = 1;
+    generation = slotGeneration;
+    return index;
+}
+
+void GpuResources::freeSlot(GpuResourceType type, unsigned int index)
+{
+    Pool& pool = pools[type];
+    pool.names[index] = 0;
+    if (++pool.generations[index] == 0)
+        pool.generations[index] = 1;
+    pool.freeSlots.push_back(index);
+}
+
+void GpuResources::destroyDeferred(GpuResourceType type, unsigned int glName)
+{
+    if (glName == 0 || !active)
+        return;
+    GpuMemory::shared().forget(type, glName);
+    PendingDelete pending = { type, glName };
+    released.push_back(pending);
+}
+
+void GpuResources::deleteObjects(const std::vector<PendingDelete>& objects)
+{
+    for (const PendingDelete& object : objects)
+    {
+        switch (object.type)
+        {
+        case GpuTexture: glDeleteTextures(1, &object.name); break;
+        case GpuBuffer: glDeleteBuffers(1, &object.name); break;
+        case GpuVertexArray: glDeleteVertexArrays(1, &object.name); break;
+        case GpuProgram: glDeleteProgram(object.name); break;
+        case GpuFramebuffer: glDeleteFramebuffers(1, &object.name); break;
+        case GpuRenderbuffer: glDeleteRenderbuffers(1, &object.name); break;
+        default: break;
+        }
+    }
+}
+
+void GpuResources::endFrame()
+{
+    if (!active)
+        return;
+
+    if (!released.empty())
+    {
+        PendingBatch batch;
+        batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        batch.objects.swap(released);
+        inFlight.push_back(std::move(batch));
+    }
+
+    // Fences signal in submission order, so stop at the first one still
+    // pending.
+    while (!inFlight.empty())
+    {
+        PendingBatch& batch = inFlight.front();
+        GLenum status = glClientWaitSync(batch.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        glDeleteSync(batch.fence);
+        deleteObjects(batch.objects);
+        inFlight.pop_front();
+    }
+}
+
+void GpuResources::shutdown()
+{
+    if (!active)
+        return;
+
+    glFinish();
+    for (PendingBatch& batch : inFlight)
+    {
+        glDeleteSync(batch.fence);
+        deleteObjects(batch.objects);
+    }
+    inFlight.clear();
+    deleteObjects(released);
+    released.clear();
+
+    // Owners that outlive this see stale handles and release nothing.
+    std::vector<PendingDelete> live;
+    for (int type = 0; type < GpuResourceTypeCount; ++type)
+    {
+        Pool& pool = pools[type];
+        for (unsigned int index = 0; index < pool.names.size(); ++index)
+        {
+            if (pool.names[index] == 0)
+                continue;
+            PendingDelete object = { (GpuResourceType)type, pool.names[index] };
+            live.push_back(object);
+            GpuMemory::shared().forget((GpuResourceType)type, pool.names[index]);
+            freeSlot((GpuResourceType)type, index);
+        }
+    }
+    deleteObjects(live);
+    active = false;
+}
+
+size_t GpuResources::liveCount(GpuResourceType type) const
+{
+    const Pool& pool = pools[type];
+    return pool.names.size() - pool.freeSlots.size();
+}
+
+size_t GpuResources::pendingCount() const
+{
+    size_t count = released.size();
+    for (const PendingBatch& batch : inFlight)
+        count += batch.objects.size();
+    return count;
+}
+
+GpuResources& GpuResources::shared()
+{
+    static GpuResources resources;
+    return resources;
+}
@@ -0,0 +1,186 @@
+#ifndef GPU_RESOURCES_H
+#define GPU_RESOURCES_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <deque>
+#include <utility>
+#include <vector>
+
+enum GpuResourceType
+{
+    GpuTexture,
+    GpuBuffer,
+    GpuVertexArray,
+    GpuProgram,
+    GpuFramebuffer,
+    GpuRenderbuffer,
+    GpuResourceTypeCount
+};
+
+// Index into a pool plus the generation the slot had when the handle was
+// made. Releasing a slot bumps its generation, so stale handles are caught
+// with one compare. Generation 0 is never issued and marks a null handle.
+template <GpuResourceType Type>
+struct GpuHandle
+{
+    unsigned int index = 0;
+    unsigned int generation = 0;
+
+    bool isNull() const { return generation == 0; }
+    bool operator==(const GpuHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const GpuHandle& other) const { return !(*this == other); }
+};
+
+// Owns every GL texture, buffer, vertex array, program, framebuffer and
+// renderbuffer. Each type has a dense pool stored as parallel arrays of GL
+// names and generations. GL objects are not deleted on release: they wait
+// in a queue behind a fence placed at the end of the frame and are only
+// deleted once the GPU has passed it. All calls must come from the thread
+// owning the GL context.
+class GpuResources
+{
+public:
+    GpuResources() = default;
+    GpuResources(const GpuResources&) = delete;
+    GpuResources& operator=(const GpuResources&) = delete;
+
+    template <GpuResourceType Type>
+    GpuHandle<Type> create()
+    {
+        return adopt<Type>(generate(Type));
+    }
+
+    template <GpuResourceType Type>
+    GpuHandle<Type> adopt(unsigned int glName)
+    {
+        GpuHandle<Type> handle;
+        handle.index = allocateSlot(Type, glName, handle.generation);
+        return handle;
+    }
+
+    // GL name for a live handle, 0 for null or stale ones.
+    template <GpuResourceType Type>
+    unsigned int get(GpuHandle<Type> handle) const
+    {
+        const Pool& pool = pools[Type];
+        if (handle.index < pool.generations.size() && pool.generations[handle.index] == handle.generation)
+            return pool.names[handle.index];
+        return 0;
+    }
+
+    template <GpuResourceType Type>
+    bool isValid(GpuHandle<Type> handle) const
+    {
+        return get(handle) != 0;
+    }
+
+    template <GpuResourceType Type>
+    void release(GpuHandle<Type> handle)
+    {
+        unsigned int name = get(handle);
+        if (name == 0)
+            return;
+        freeSlot(Type, handle.index);
+        destroyDeferred(Type, name);
+    }
+
+    // Queues a GL name that is not pooled (meshes, for instance) for the
+    // same fenced deletion.
+    void destroyDeferred(GpuResourceType type, unsigned int glName);
+
+    // Fences this frame's releases and deletes the objects whose fences
+    // the GPU has passed. Call once per frame after submitting it.
+    void endFrame();
+
+    // Deletes everything, live or pending. Later releases become no-ops,
+    // since the context is about to go away.
+    void shutdown();
+
+    size_t liveCount(GpuResourceType type) const;
+    size_t pendingCount() const;
+
+    static GpuResources& shared();
+
+private:
+    struct Pool
+    {
+        std::vector<unsigned int> names;
+        std::vector<unsigned int> generations;
+        std::vector<unsigned int> freeSlots;
+    };
+
+    struct PendingDelete
+    {
+        GpuResourceType type;
+        unsigned int name;
+    };
+
+    struct PendingBatch
+    {
+        GLsync fence;
+        std::vector<PendingDelete> objects;
+    };
+
+    unsigned int generate(GpuResourceType type);
+    unsigned int allocateSlot(GpuResourceType type, unsigned int glName, unsigned int& generation);
+    void freeSlot(GpuResourceType type, unsigned int index);
+    void deleteObjects(const std::vector<PendingDelete>& objects);
+
+    Pool pools[GpuResourceTypeCount];
+    std::vector<PendingDelete> released;
+    std::deque<PendingBatch> inFlight;
+    bool active = true;
+};
+
+// Move-only owner of one pooled GL object; releasing it goes through the
+// deferred queue.
+template <GpuResourceType Type>
+class GpuObject
+{
+public:
+    GpuObject() = default;
+    explicit GpuObject(GpuHandle<Type> owned) : slot(owned) {}
+    ~GpuObject() { reset(); }
+
+    GpuObject(const GpuObject&) = delete;
+    GpuObject& operator=(const GpuObject&) = delete;
+
+    GpuObject(GpuObject&& other) noexcept : slot(other.slot) { other.slot = GpuHandle<Type>(); }
+    GpuObject& operator=(GpuObject&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            slot = other.slot;
+            other.slot = GpuHandle<Type>();
+        }
+        return *this;
+    }
+
+    static GpuObject create() { return GpuObject(GpuResources::shared().create<Type>()); }
+    static GpuObject adopt(unsigned int glName) { return GpuObject(GpuResources::shared().adopt<Type>(glName)); }
+
+    unsigned int id() const { return GpuResources::shared().get(slot); }
+    GpuHandle<Type> handle() const { return slot; }
+    explicit operator bool() const { return id() != 0; }
+
+    void reset()
+    {
+        if (!slot.isNull())
+            GpuResources::shared().release(slot);
+        slot = GpuHandle<Type>();
+    }
+
+private:
+    GpuHandle<Type> slot;
+};
+
+typedef GpuObject<GpuTexture> TextureObject;
+typedef GpuObject<GpuBuffer> BufferObject;
+typedef GpuObject<GpuVertexArray> VertexArrayObject;
+typedef GpuObject<GpuProgram> ProgramObject;
+typedef GpuObject<GpuFramebuffer> FramebufferObject;
+typedef GpuObject<GpuRenderbuffer> RenderbufferObject;
+
+#endif
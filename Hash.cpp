@@ -0,0 +1,101 @@
+#include "Hash.h"
+#include <cstring>
+
+static const unsigned long long Prime1 = 0x9E3779B185EBCA87ull;
+static const unsigned long long Prime2 = 0xC2B2AE3D27D4EB4Full;
+static const unsigned long long Prime3 = 0x165667B19E3779F9ull;
+static const unsigned long long Prime4 = 0x85EBCA77C2B2AE63ull;
+static const unsigned long long Prime5 = 0x27D4EB2F165667C5ull;
+
+static inline unsigned long long rotateLeft(unsigned long long value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Little-endian loads; every supported target is little-endian.
+static inline unsigned long long read64(const unsigned char* p)
+{
+    unsigned long long value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline unsigned long long read32(const unsigned char* p)
+{
+    unsigned int value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline unsigned long long round64(unsigned long long accumulator, unsigned long long input)
+{
+    accumulator += input * Prime2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * Prime1;
+}
+
+static inline unsigned long long mergeRound(unsigned long long hash, unsigned long long accumulator)
+{
+    hash ^= round64(0, accumulator);
+    return hash * Prime1 + Prime4;
+}
+
+unsigned long long hashBytes(const void* data, size_t size, unsigned long long seed)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + size;
+    unsigned long long hash;
+
+    if (size >= 32)
+    {
+        // Four independent lanes over 32-byte stripes.
+        unsigned long long v1 = seed + Prime1 + Prime2;
+        unsigned long long v2 = seed + Prime2;
+        unsigned long long v3 = seed;
+        unsigned long long v4 = seed - Prime1;
+        const unsigned char* limit = end - 32;
+        do
+        {
+            v1 = round64(v1, read64(p));
+            v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16));
+            v4 = round64(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        hash = mergeRound(hash, v1);
+        hash = mergeRound(hash, v2);
+        hash = mergeRound(hash, v3);
+        hash = mergeRound(hash, v4);
+    }
+    else
+    {
+        hash = seed + Prime5;
+    }
+
+    hash += (unsigned long long)size;
+    for (; p + 8 <= end; p += 8)
+    {
+        hash ^= round64(0, read64(p));
+        hash = rotateLeft(hash, 27) * Prime1 + Prime4;
+    }
+    if (p + 4 <= end)
+    {
+        hash ^= read32(p) * Prime1;
+        hash = rotateLeft(hash, 23) * Prime2 + Prime3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+    {
+        hash ^= *p * Prime5;
+        hash = rotateLeft(hash, 11) * Prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= Prime2;
+    hash ^= hash >> 29;
+    hash *= Prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
@@ -0,0 +1,10 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+
+// XXH64 (xxHash, 64-bit variant). Fast non-cryptographic hash for content
+// keys; output matches the reference implementation.
+unsigned long long hashBytes(const void* data, size_t size, unsigned long long seed = 0);
+
+#endif
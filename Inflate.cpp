@@ -0,0 +1,418 @@
+#include "Inflate.h"
+#include <cstring>
+
+namespace
+{
+    const int FastBits = 10;
+    const int FastSize = 1 << FastBits;
+    const int MaxCodeLength = 15;
+
+    // Table entry: value << 16 | type << 12 | extra bits << 8 | code length.
+    // A zero entry means the code is longer than FastBits.
+    enum EntryType
+    {
+        EntryLiteral,    // also distances and code-length symbols
+        EntryLength,
+        EntryEnd,
+        EntryInvalid
+    };
+
+    enum Alphabet
+    {
+        AlphabetLiteralLength,
+        AlphabetDistance,
+        AlphabetCodeLength
+    };
+
+    const unsigned short LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+        67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const unsigned char LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+        5, 5, 5, 5, 0 };
+    const unsigned short DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+        513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const unsigned char DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10,
+        10, 11, 11, 12, 12, 13, 13 };
+    const unsigned char CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    inline unsigned int makeEntry(unsigned int value, unsigned int type, unsigned int extra)
+    {
+        return (value << 16) | (type << 12) | (extra << 8);
+    }
+
+    unsigned int symbolEntry(Alphabet alphabet, unsigned int symbol)
+    {
+        if (alphabet == AlphabetLiteralLength)
+        {
+            if (symbol < 256)
+                return makeEntry(symbol, EntryLiteral, 0);
+            if (symbol == 256)
+                return makeEntry(0, EntryEnd, 0);
+            if (symbol < 286)
+                return makeEntry(LengthBase[symbol - 257], EntryLength, LengthExtra[symbol - 257]);
+            return makeEntry(0, EntryInvalid, 0);
+        }
+        if (alphabet == AlphabetDistance)
+        {
+            if (symbol < 30)
+                return makeEntry(DistanceBase[symbol], EntryLiteral, DistanceExtra[symbol]);
+            return makeEntry(0, EntryInvalid, 0);
+        }
+        return makeEntry(symbol, EntryLiteral, 0);
+    }
+
+    struct Huffman
+    {
+        Alphabet alphabet;
+        unsigned int fast[FastSize];
+        unsigned short counts[MaxCodeLength + 1];
+        unsigned short symbols[288];    // ordered by code
+    };
+
+    inline unsigned int reverseBits(unsigned int code, int length)
+    {
+        unsigned int reversed = 0;
+        for (int i = 0; i < length; ++i)
+        {
+            reversed = (reversed << 1) | (code & 1);
+            code >>= 1;
+        }
+        return reversed;
+    }
+
+    // Canonical code from code lengths. Incomplete codes are allowed, as
+    // deflate uses them for single-distance blocks; unused codes decode as
+    // invalid.
+    bool buildHuffman(Huffman& table, Alphabet alphabet, const unsigned char* lengths, int count)
+    {
+        table.alphabet = alphabet;
+        memset(table.counts, 0, sizeof(table.counts));
+        for (int s = 0; s < count; ++s)
+            ++table.counts[lengths[s]];
+        table.counts[0] = 0;
+
+        int left = 1;
+        for (int length = 1; length <= MaxCodeLength; ++length)
+        {
+            left = (left << 1) - table.counts[length];
+            if (left < 0)
+                return false;
+        }
+
+        unsigned short offsets[MaxCodeLength + 2];
+        unsigned int nextCode[MaxCodeLength + 1];
+        offsets[1] = 0;
+        nextCode[0] = 0;
+        unsigned int code = 0;
+        for (int length = 1; length <= MaxCodeLength; ++length)
+        {
+            offsets[length + 1] = offsets[length] + table.counts[length];
+            code = (code + table.counts[length - 1]) << 1;
+            nextCode[length] = code;
+        }
+        for (int s = 0; s < count; ++s)
+        {
+            if (lengths[s])
+                table.symbols[offsets[lengths[s]]++] = (unsigned short)s;
+        }
+
+        memset(table.fast, 0, sizeof(table.fast));
+        for (int s = 0; s < count; ++s)
+        {
+            int length = lengths[s];
+            if (length == 0)
+                continue;
+            unsigned int symbolCode = nextCode[length]++;
+            if (length > FastBits)
+                continue;
+            unsigned int entry = symbolEntry(alphabet, s) | (unsigned int)length;
+            for (unsigned int j = reverseBits(symbolCode, length); j < (unsigned int)FastSize; j += 1u << length)
+                table.fast[j] = entry;
+        }
+        return true;
+    }
+
+    // LSB-first bit buffer. While eight input bytes remain, a refill ORs a
+    // whole little-endian word in; the bits above count then already hold
+    // the next input, so rereading them later is harmless. Past the end it
+    // pads with zero bytes and counts them.
+    struct BitReader
+    {
+        const unsigned char* in;
+        const unsigned char* end;
+        unsigned long long bits = 0;
+        int count = 0;
+        size_t padding = 0;
+
+        void refill()
+        {
+            if (end - in >= 8)
+            {
+                unsigned long long word;
+                memcpy(&word, in, 8);
+                bits |= word << count;
+                in += (63 - count) >> 3;
+                count |= 56;
+                return;
+            }
+            while (count <= 56)
+            {
+                unsigned long long byte = 0;
+                if (in < end)
+                    byte = *in++;
+                else
+                    ++padding;
+                bits |= byte << count;
+                count += 8;
+            }
+        }
+
+        unsigned int take(int n)
+        {
+            unsigned int value = (unsigned int)(bits & ((1ull << n) - 1));
+            bits >>= n;
+            count -= n;
+            return value;
+        }
+
+        // Drops the partial byte and hands buffered whole bytes back to the
+        // input, for stored blocks.
+        void alignToByte()
+        {
+            take(count & 7);
+            for (int bytes = count >> 3; bytes > 0; --bytes)
+            {
+                if (padding > 0)
+                    --padding;
+                else
+                    --in;
+            }
+            bits = 0;
+            count = 0;
+        }
+    };
+
+    // Needs at least MaxCodeLength bits buffered.
+    inline unsigned int decodeSymbol(BitReader& reader, const Huffman& table)
+    {
+        unsigned int entry = table.fast[reader.bits & (FastSize - 1)];
+        if (entry)
+        {
+            reader.take(entry & 0xFF);
+            return entry;
+        }
+
+        // Long code: walk the canonical code one bit at a time.
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for (int length = 1; length <= MaxCodeLength; ++length)
+        {
+            code |= (int)((reader.bits >> (length - 1)) & 1);
+            int count = table.counts[length];
+            if (code - first < count)
+            {
+                reader.take(length);
+                return symbolEntry(table.alphabet, table.symbols[index + code - first]);
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return makeEntry(0, EntryInvalid, 0);
+    }
+
+    bool readDynamicTables(BitReader& reader, Huffman& literals, Huffman& distances)
+    {
+        reader.refill();
+        int literalCount = (int)reader.take(5) + 257;
+        int distanceCount = (int)reader.take(5) + 1;
+        int codeLengthCount = (int)reader.take(4) + 4;
+        if (literalCount > 286 || distanceCount > 30)
+            return false;
+
+        unsigned char codeLengths[19] = {};
+        for (int i = 0; i < codeLengthCount; ++i)
+        {
+            reader.refill();
+            codeLengths[CodeLengthOrder[i]] = (unsigned char)reader.take(3);
+        }
+        Huffman codeLengthTable;
+        if (!buildHuffman(codeLengthTable, AlphabetCodeLength, codeLengths, 19))
+            return false;
+
+        unsigned char lengths[286 + 30];
+        int total = literalCount + distanceCount;
+        int n = 0;
+        while (n < total)
+        {
+            reader.refill();
+            unsigned int entry = decodeSymbol(reader, codeLengthTable);
+            if (((entry >> 12) & 3) == EntryInvalid)
+                return false;
+            unsigned int symbol = entry >> 16;
+            if (symbol < 16)
+            {
+                lengths[n++] = (unsigned char)symbol;
+                continue;
+            }
+
+            unsigned char value = 0;
+            int repeat;
+            if (symbol == 16)
+            {
+                if (n == 0)
+                    return false;
+                value = lengths[n - 1];
+                repeat = 3 + (int)reader.take(2);
+            }
+            else if (symbol == 17)
+                repeat = 3 + (int)reader.take(3);
+            else
+                repeat = 11 + (int)reader.take(7);
+            if (repeat > total - n)
+                return false;
+            memset(lengths + n, value, repeat);
+            n += repeat;
+        }
+
+        if (lengths[256] == 0)
+            return false;
+        return buildHuffman(literals, AlphabetLiteralLength, lengths, literalCount) &&
+            buildHuffman(distances, AlphabetDistance, lengths + literalCount, distanceCount);
+    }
+
+    void buildFixedTables(Huffman& literals, Huffman& distances)
+    {
+        unsigned char lengths[288];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 112);
+        memset(lengths + 256, 7, 24);
+        memset(lengths + 280, 8, 8);
+        buildHuffman(literals, AlphabetLiteralLength, lengths, 288);
+        memset(lengths, 5, 30);
+        buildHuffman(distances, AlphabetDistance, lengths, 30);
+    }
+
+    bool inflateBlock(BitReader& reader, const Huffman& literals, const Huffman& distances,
+        unsigned char* start, unsigned char*& out, unsigned char* outEnd)
+    {
+        for (;;)
+        {
+            // Worst case per iteration is 15 + 5 bits of length and 15 + 13
+            // of distance, so one refill covers it.
+            reader.refill();
+            if (reader.padding > 8)
+                return false;
+
+            unsigned int entry = decodeSymbol(reader, literals);
+            unsigned int type = (entry >> 12) & 3;
+            if (type == EntryLiteral)
+            {
+                if (out == outEnd)
+                    return false;
+                *out++ = (unsigned char)(entry >> 16);
+                continue;
+            }
+            if (type == EntryEnd)
+                return true;
+            if (type == EntryInvalid)
+                return false;
+
+            size_t length = (entry >> 16) + reader.take((entry >> 8) & 15);
+            entry = decodeSymbol(reader, distances);
+            if (((entry >> 12) & 3) == EntryInvalid)
+                return false;
+            size_t distance = (entry >> 16) + reader.take((entry >> 8) & 15);
+            if (distance > (size_t)(out - start) || length > (size_t)(outEnd - out))
+                return false;
+
+            const unsigned char* from = out - distance;
+            if (distance >= 8 && length + 8 <= (size_t)(outEnd - out))
+            {
+                // May write up to 7 bytes past the match; they are inside
+                // the buffer and get overwritten by what follows.
+                unsigned char* stop = out + length;
+                do
+                {
+                    memcpy(out, from, 8);
+                    out += 8;
+                    from += 8;
+                } while (out < stop);
+                out = stop;
+            }
+            else if (distance == 1)
+            {
+                memset(out, out[-1], length);
+                out += length;
+            }
+            else
+            {
+                for (size_t i = 0; i < length; ++i)
+                    out[i] = from[i];
+                out += length;
+            }
+        }
+    }
+}
+
+bool inflateZlib(const unsigned char* source, size_t size, unsigned char* destination, size_t capacity, size_t& written)
+{
+    written = 0;
+    if (size < 2)
+        return false;
+    unsigned int method = source[0];
+    unsigned int flags = source[1];
+    if ((method & 15) != 8 || (method >> 4) > 7 || (method * 256 + flags) % 31 != 0 || (flags & 32))
+        return false;
+
+    BitReader reader;
+    reader.in = source + 2;
+    reader.end = source + size;
+
+    Huffman literals;
+    Huffman distances;
+    unsigned char* out = destination;
+    unsigned char* outEnd = destination + capacity;
+    bool last = false;
+    while (!last)
+    {
+        reader.refill();
+        last = reader.take(1) != 0;
+        unsigned int type = reader.take(2);
+        if (type == 0)
+        {
+            reader.alignToByte();
+            if (reader.end - reader.in < 4)
+                return false;
+            unsigned int length = reader.in[0] | (reader.in[1] << 8);
+            unsigned int complement = reader.in[2] | (reader.in[3] << 8);
+            reader.in += 4;
+            if (length != (~complement & 0xFFFF) || length > (size_t)(reader.end - reader.in) ||
+                length > (size_t)(outEnd - out))
+                return false;
+            memcpy(out, reader.in, length);
+            reader.in += length;
+            out += length;
+            continue;
+        }
+
+        if (type == 1)
+            buildFixedTables(literals, distances);
+        else if (type == 2)
+        {
+            if (!readDynamicTables(reader, literals, distances))
+                return false;
+        }
+        else
+            return false;
+
+        if (!inflateBlock(reader, literals, distances, destination, out, outEnd))
+            return false;
+    }
+
+    // Fail if the stream ended inside the padding.
+    if (reader.padding > (size_t)(reader.count >> 3))
+        return false;
+    written = (size_t)(out - destination);
+    return true;
+}
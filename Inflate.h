@@ -0,0 +1,15 @@
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include <cstddef>
+
+// Decompresses a zlib stream (RFC 1950/1951) into destination, writing at
+// most capacity bytes; written receives the decoded size. Huffman codes of
+// up to 10 bits resolve with one table lookup that also yields the length
+// or distance base, the bit buffer refills eight bytes at a time, and
+// matches copy in 8-byte chunks. All state lives on the stack, so any
+// number of streams can be inflated concurrently. The Adler-32 trailer is
+// not checked.
+bool inflateZlib(const unsigned char* source, size_t size, unsigned char* destination, size_t capacity, size_t& written);
+
+#endif
@@ -0,0 +1,144 @@
+#include "JpegSimd.h"
+#include "Simd.h"
+#include <cstring>
+
+// stb's constants: 1.402, -0.71414, -0.34414 and 1.772 in 4.12 fixed point.
+static const short CrToR = (short)(1.40200f * 4096.0f + 0.5f);
+static const short CrToG = -(short)(0.71414f * 4096.0f + 0.5f);
+static const short CbToG = -(short)(0.34414f * 4096.0f + 0.5f);
+static const short CbToB = (short)(1.77200f * 4096.0f + 0.5f);
+
+#if SIMD_SSE2
+// Writes four RGBA pixels, or drops alpha for step == 3. The 3-channel
+// store is split so it never writes past the 12 bytes it owns.
+static inline void storePixels(unsigned char* out, __m128i rgba, int step)
+{
+    if (step == 4)
+    {
+        _mm_storeu_si128((__m128i*)out, rgba);
+        return;
+    }
+#if SIMD_SSSE3
+    const __m128i dropAlpha = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m128i rgb = _mm_shuffle_epi8(rgba, dropAlpha);
+    _mm_storel_epi64((__m128i*)out, rgb);
+    int tail = _mm_cvtsi128_si32(_mm_srli_si128(rgb, 8));
+    memcpy(out + 8, &tail, 4);
+#endif
+}
+
+// Eight pixels in 16-bit lanes, exactly as stbi__YCbCr_to_RGB_simd.
+static inline void convertEight(__m128i yBytes, __m128i cbBytes, __m128i crBytes, __m128i& first, __m128i& second)
+{
+    const __m128i signFlip = _mm_set1_epi8(-0x80);
+    const __m128i yBias = _mm_set1_epi8((char)128);
+    const __m128i alpha = _mm_set1_epi16(255);
+
+    __m128i yw = _mm_unpacklo_epi8(yBias, yBytes);
+    __m128i crw = _mm_unpacklo_epi8(_mm_setzero_si128(), _mm_xor_si128(crBytes, signFlip));
+    __m128i cbw = _mm_unpacklo_epi8(_mm_setzero_si128(), _mm_xor_si128(cbBytes, signFlip));
+
+    __m128i yws = _mm_srli_epi16(yw, 4);
+    __m128i r = _mm_add_epi16(_mm_mulhi_epi16(_mm_set1_epi16(CrToR), crw), yws);
+    __m128i g = _mm_add_epi16(_mm_add_epi16(_mm_mulhi_epi16(_mm_set1_epi16(CbToG), cbw), yws),
+        _mm_mulhi_epi16(crw, _mm_set1_epi16(CrToG)));
+    __m128i b = _mm_add_epi16(yws, _mm_mulhi_epi16(cbw, _mm_set1_epi16(CbToB)));
+
+    __m128i rb = _mm_packus_epi16(_mm_srai_epi16(r, 4), _mm_srai_epi16(b, 4));
+    __m128i ga = _mm_packus_epi16(_mm_srai_epi16(g, 4), alpha);
+    __m128i low = _mm_unpacklo_epi8(rb, ga);
+    __m128i high = _mm_unpackhi_epi8(rb, ga);
+    first = _mm_unpacklo_epi16(low, high);
+    second = _mm_unpackhi_epi16(low, high);
+}
+#endif
+
+void convertYCbCrToRgb(unsigned char* out, const unsigned char* y, const unsigned char* cb, const unsigned char* cr,
+    int count, int step)
+{
+    int i = 0;
+#if SIMD_SSE2
+#if SIMD_SSSE3
+    bool vectorized = step == 3 || step == 4;
+#else
+    bool vectorized = step == 4;
+#endif
+    if (vectorized)
+    {
+#if SIMD_AVX2
+        const __m256i signFlip = _mm256_set1_epi8(-0x80);
+        const __m256i yBias = _mm256_set1_epi16(128);
+        const __m256i alpha = _mm256_set1_epi16(255);
+        for (; i + 16 <= count; i += 16)
+        {
+            __m256i yw = _mm256_or_si256(
+                _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + i))), 8), yBias);
+            __m128i crBiased = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(cr + i)), _mm256_castsi256_si128(signFlip));
+            __m128i cbBiased = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(cb + i)), _mm256_castsi256_si128(signFlip));
+            __m256i crw = _mm256_slli_epi16(_mm256_cvtepu8_epi16(crBiased), 8);
+            __m256i cbw = _mm256_slli_epi16(_mm256_cvtepu8_epi16(cbBiased), 8);
+
+            __m256i yws = _mm256_srli_epi16(yw, 4);
+            __m256i r = _mm256_add_epi16(_mm256_mulhi_epi16(_mm256_set1_epi16(CrToR), crw), yws);
+            __m256i g = _mm256_add_epi16(_mm256_add_epi16(_mm256_mulhi_epi16(_mm256_set1_epi16(CbToG), cbw), yws),
+                _mm256_mulhi_epi16(crw, _mm256_set1_epi16(CrToG)));
+            __m256i b = _mm256_add_epi16(yws, _mm256_mulhi_epi16(cbw, _mm256_set1_epi16(CbToB)));
+
+            // Packs and unpacks stay within 128-bit lanes: lane 0 holds
+            // pixels 0-7, lane 1 pixels 8-15.
+            __m256i rb = _mm256_packus_epi16(_mm256_srai_epi16(r, 4), _mm256_srai_epi16(b, 4));
+            __m256i ga = _mm256_packus_epi16(_mm256_srai_epi16(g, 4), alpha);
+            __m256i low = _mm256_unpacklo_epi8(rb, ga);
+            __m256i high = _mm256_unpackhi_epi8(rb, ga);
+            __m256i first = _mm256_unpacklo_epi16(low, high);
+            __m256i second = _mm256_unpackhi_epi16(low, high);
+            __m256i pixels0 = _mm256_permute2x128_si256(first, second, 0x20);
+            __m256i pixels1 = _mm256_permute2x128_si256(first, second, 0x31);
+
+            if (step == 4)
+            {
+                _mm256_storeu_si256((__m256i*)out, pixels0);
+                _mm256_storeu_si256((__m256i*)(out + 32), pixels1);
+            }
+            else
+            {
+                storePixels(out, _mm256_castsi256_si128(pixels0), 3);
+                storePixels(out + 12, _mm256_extracti128_si256(pixels0, 1), 3);
+                storePixels(out + 24, _mm256_castsi256_si128(pixels1), 3);
+                storePixels(out + 36, _mm256_extracti128_si256(pixels1, 1), 3);
+            }
+            out += 16 * step;
+        }
+#endif
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i first, second;
+            convertEight(_mm_loadl_epi64((const __m128i*)(y + i)), _mm_loadl_epi64((const __m128i*)(cb + i)),
+                _mm_loadl_epi64((const __m128i*)(cr + i)), first, second);
+            storePixels(out, first, step);
+            storePixels(out + 4 * step, second, step);
+            out += 8 * step;
+        }
+    }
+#endif
+
+    // Scalar tail, the same reduced-precision formula as stb.
+    for (; i < count; ++i)
+    {
+        int yFixed = (y[i] << 20) + (1 << 19);
+        int crValue = cr[i] - 128;
+        int cbValue = cb[i] - 128;
+        int r = yFixed + crValue * (CrToR * 256);
+        int g = yFixed + crValue * (CrToG * 256) + (int)((cbValue * (CbToG * 256)) & 0xffff0000);
+        int b = yFixed + cbValue * (CbToB * 256);
+        r >>= 20;
+        g >>= 20;
+        b >>= 20;
+        out[0] = (unsigned char)(r < 0 ? 0 : (r > 255 ? 255 : r));
+        out[1] = (unsigned char)(g < 0 ? 0 : (g > 255 ? 255 : g));
+        out[2] = (unsigned char)(b < 0 ? 0 : (b > 255 ? 255 : b));
+        if (step == 4)
+            out[3] = 255;
+        out += step;
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef JPEG_SIMD_H
+#define JPEG_SIMD_H
+
+// YCbCr -> RGB(A) row conversion for stb_image's JPEG decoder, installed in
+// place of stb's kernels by stb_image.cpp. Uses the same 12-bit fixed-point
+// arithmetic as stb's scalar and SSE2 kernels, so output is identical bit for
+// bit. AVX2 builds convert 16 pixels per step, and with SSSE3 the 3-channel
+// layout is vectorized too; stb's own SIMD kernel only handles step == 4.
+void convertYCbCrToRgb(unsigned char* out, const unsigned char* y, const unsigned char* cb, const unsigned char* cr,
+    int count, int step);
+
+#endif
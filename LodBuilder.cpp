@@ -0,0 +1,295 @@
+#include "LodBuilder.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <queue>
+#include <tuple>
+
+namespace
+{
+    // Symmetric 4x4 quadric stored as its 10 unique coefficients.
+    struct Quadric
+    {
+        double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+        void addPlane(double a, double b, double c, double d, double weight)
+        {
+            a2 += weight * a * a; ab += weight * a * b; ac += weight * a * c; ad += weight * a * d;
+            b2 += weight * b * b; bc += weight * b * c; bd += weight * b * d;
+            c2 += weight * c * c; cd += weight * c * d;
+            d2 += weight * d * d;
+        }
+
+        void add(const Quadric& q)
+        {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2;
+            bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+        }
+
+        double evaluate(const float* p) const
+        {
+            double x = p[0], y = p[1], z = p[2];
+            double result = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                          + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                          + c2 * z * z + 2 * cd * z + d2;
+            return result > 0.0 ? result : 0.0;
+        }
+    };
+
+    struct Collapse
+    {
+        double cost;
+        unsigned int from, to;
+        unsigned int fromVersion, toVersion;
+        bool operator<(const Collapse& other) const { return cost > other.cost; }
+    };
+
+    void cross(const float* a, const float* b, const float* c, double* n)
+    {
+        double e1[3] = { (double)b[0] - a[0], (double)b[1] - a[1], (double)b[2] - a[2] };
+        double e2[3] = { (double)c[0] - a[0], (double)c[1] - a[1], (double)c[2] - a[2] };
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+}
+
+std::vector<unsigned int> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t targetIndexCount, float targetError, float* error)
+{
+    size_t vertexCount = vertices.size();
+    size_t triangleCount = indices.size() / 3;
+
+    float extentMin[3] = { INFINITY, INFINITY, INFINITY }, extentMax[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (const Vertex& v : vertices)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            extentMin[k] = std::min(extentMin[k], v.position[k]);
+            extentMax[k] = std::max(extentMax[k], v.position[k]);
+        }
+    }
+    double scale = 0.0;
+    for (int k = 0; k < 3; ++k)
+        scale = std::max(scale, (double)extentMax[k] - extentMin[k]);
+    if (scale <= 0.0)
+        scale = 1.0;
+    double maxCost = (double)targetError * scale * (double)targetError * scale;
+
+    // Seam vertices (same position, different attributes) stay where they are.
+    std::vector<unsigned char> locked(vertexCount, 0);
+    std::map<std::tuple<float, float, float>, unsigned int> firstAtPosition;
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        auto key = std::make_tuple(vertices[v].position[0], vertices[v].position[1], vertices[v].position[2]);
+        auto inserted = firstAtPosition.emplace(key, v);
+        if (!inserted.second)
+            locked[v] = locked[inserted.first->second] = 1;
+    }
+
+    std::vector<unsigned int> tris(indices.begin(), indices.begin() + triangleCount * 3);
+    std::vector<unsigned char> removed(triangleCount, 0);
+    std::vector<std::vector<unsigned int>> vertexTriangles(vertexCount);
+    std::vector<Quadric> quadrics(vertexCount, Quadric());
+
+    std::map<std::pair<unsigned int, unsigned int>, int> edgeUse;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        const unsigned int* tri = &tris[t * 3];
+        double n[3];
+        cross(vertices[tri[0]].position, vertices[tri[1]].position, vertices[tri[2]].position, n);
+        double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 0.0)
+        {
+            double a = n[0] / length, b = n[1] / length, c = n[2] / length;
+            const float* p = vertices[tri[0]].position;
+            double d = -(a * p[0] + b * p[1] + c * p[2]);
+            for (int k = 0; k < 3; ++k)
+                quadrics[tri[k]].addPlane(a, b, c, d, 1.0);
+        }
+        for (int k = 0; k < 3; ++k)
+        {
+            vertexTriangles[tri[k]].push_back((unsigned int)t);
+            unsigned int a = tri[k], b = tri[(k + 1) % 3];
+            ++edgeUse[std::make_pair(std::min(a, b), std::max(a, b))];
+        }
+    }
+
+    // Border edges get a heavily weighted plane perpendicular to the face so
+    // open boundaries keep their outline.
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        const unsigned int* tri = &tris[t * 3];
+        double n[3];
+        cross(vertices[tri[0]].position, vertices[tri[1]].position, vertices[tri[2]].position, n);
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int a = tri[k], b = tri[(k + 1) % 3];
+            if (edgeUse[std::make_pair(std::min(a, b), std::max(a, b))] != 1)
+                continue;
+            const float* pa = vertices[a].position;
+            const float* pb = vertices[b].position;
+            double e[3] = { (double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2] };
+            double p[3] = { e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0] };
+            double length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+            if (length <= 0.0)
+                continue;
+            double nx = p[0] / length, ny = p[1] / length, nz = p[2] / length;
+            double d = -(nx * pa[0] + ny * pa[1] + nz * pa[2]);
+            quadrics[a].addPlane(nx, ny, nz, d, 10.0);
+            quadrics[b].addPlane(nx, ny, nz, d, 10.0);
+        }
+    }
+
+    std::vector<unsigned int> version(vertexCount, 0);
+    std::vector<unsigned int> remap(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+        remap[v] = v;
+
+    std::priority_queue<Collapse> queue;
+    auto pushEdge = [&](unsigned int a, unsigned int b)
+    {
+        for (int direction = 0; direction < 2; ++direction)
+        {
+            unsigned int from = direction ? b : a, to = direction ? a : b;
+            if (locked[from])
+                continue;
+            Quadric q = quadrics[from];
+            q.add(quadrics[to]);
+            queue.push({ q.evaluate(vertices[to].position), from, to, version[from], version[to] });
+        }
+    };
+    for (const auto& edge : edgeUse)
+        pushEdge(edge.first.first, edge.first.second);
+
+    size_t liveTriangles = triangleCount;
+    double worstCost = 0.0;
+    while (liveTriangles * 3 > targetIndexCount && !queue.empty())
+    {
+        Collapse c = queue.top();
+        queue.pop();
+        if (c.cost > maxCost)
+            break;
+        if (remap[c.from] != c.from || remap[c.to] != c.to
+            || version[c.from] != c.fromVersion || version[c.to] != c.toVersion)
+            continue;
+
+        // Reject collapses that would flip a surviving triangle.
+        bool flips = false;
+        for (unsigned int t : vertexTriangles[c.from])
+        {
+            if (removed[t]) continue;
+            const unsigned int* tri = &tris[t * 3];
+            if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) continue;
+            double before[3], after[3];
+            const float* p[3];
+            for (int k = 0; k < 3; ++k) p[k] = vertices[tri[k]].position;
+            cross(p[0], p[1], p[2], before);
+            for (int k = 0; k < 3; ++k) if (tri[k] == c.from) p[k] = vertices[c.to].position;
+            cross(p[0], p[1], p[2], after);
+            if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0)
+            {
+                flips = true;
+                break;
+            }
+        }
+        if (flips)
+            continue;
+
+        remap[c.from] = c.to;
+        quadrics[c.to].add(quadrics[c.from]);
+        ++version[c.to];
+        worstCost = std::max(worstCost, c.cost);
+
+        for (unsigned int t : vertexTriangles[c.from])
+        {
+            if (removed[t]) continue;
+            unsigned int* tri = &tris[t * 3];
+            for (int k = 0; k < 3; ++k)
+                if (tri[k] == c.from) tri[k] = c.to;
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+            {
+                removed[t] = 1;
+                --liveTriangles;
+            }
+            else
+            {
+                vertexTriangles[c.to].push_back(t);
+            }
+        }
+        vertexTriangles[c.from].clear();
+
+        for (unsigned int t : vertexTriangles[c.to])
+        {
+            if (removed[t]) continue;
+            const unsigned int* tri = &tris[t * 3];
+            for (int k = 0; k < 3; ++k)
+                if (tri[k] != c.to)
+                    pushEdge(c.to, tri[k]);
+        }
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(liveTriangles * 3);
+    for (size_t t = 0; t < triangleCount; ++t)
+        if (!removed[t])
+            result.insert(result.end(), &tris[t * 3], &tris[t * 3] + 3);
+
+    if (error)
+        *error = (float)(std::sqrt(worstCost) / scale);
+    return result;
+}
+
+void buildLodChain(MeshData& mesh, unsigned int levelCount, float maxError)
+{
+    mesh.lods.clear();
+    mesh.lods.push_back({ 0, (unsigned int)mesh.indices.size(), 0.0f });
+
+    std::vector<unsigned int> previous = mesh.indices;
+    for (unsigned int level = 1; level < levelCount; ++level)
+    {
+        float levelError = 0.0f;
+        std::vector<unsigned int> lod = simplifyMesh(mesh.vertices, previous, previous.size() / 2, maxError, &levelError);
+        if (lod.empty() || lod.size() > previous.size() * 85 / 100)
+            break;
+
+        optimizeVertexCache(lod, mesh.vertices.size());
+        // Each level is simplified from the previous one, so its distance
+        // to the original is bounded by the sum of the steps, not the max.
+        float error = mesh.lods.back().error + levelError;
+        mesh.lods.push_back({ (unsigned int)mesh.indices.size(), (unsigned int)lod.size(), error });
+        mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+        previous.swap(lod);
+    }
+}
+
+void buildLodChains(std::vector<MeshData>& meshes, ThreadPool& pool, unsigned int levelCount, float maxError)
+{
+    pool.parallelFor(meshes.size(), [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            buildLodChain(meshes[i], levelCount, maxError);
+    });
+}
+
+float projectedScreenSize(float radius, float distance, float fovY, float viewportHeight)
+{
+    if (distance <= radius)
+        return viewportHeight;
+    return radius / (distance * std::tan(0.5f * fovY)) * viewportHeight;
+}
+
+unsigned int selectLod(const std::vector<IndexRange>& lods, float screenSize, unsigned int currentLevel,
+    float pixelThreshold, float hysteresis)
+{
+    unsigned int selected = 0;
+    for (unsigned int level = 1; level < lods.size(); ++level)
+    {
+        float threshold = level > currentLevel ? pixelThreshold * (1.0f - hysteresis) : pixelThreshold;
+        if (lods[level].error * screenSize > threshold)
+            break;
+        selected = level;
+    }
+    return selected;
+}
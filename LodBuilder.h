@@ -0,0 +1,36 @@
+#ifndef LOD_BUILDER_H
+#define LOD_BUILDER_H
+
+#include "Mesh.h"
+#include "ThreadPool.h"
+#include <vector>
+
+// Quadric error metric edge collapse. Vertices only ever collapse onto an
+// existing neighbour, so every level indexes the same vertex buffer and a
+// LOD switch is just a different index range. Vertices that share a
+// position with another vertex (UV or normal seams) are locked.
+// Returns the simplified index list; error receives the largest collapse
+// error relative to the mesh extent.
+std::vector<unsigned int> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t targetIndexCount, float targetError, float* error = nullptr);
+
+// Appends up to levelCount - 1 coarser levels behind the original indices
+// and records every level in mesh.lods. Each level aims for half the
+// triangles of the previous one within maxError; a level that cannot get
+// below 85% of its parent ends the chain. The recorded error of a level
+// is the sum of the errors of every step down to it.
+void buildLodChain(MeshData& mesh, unsigned int levelCount = 4, float maxError = 0.05f);
+
+// Builds chains for many meshes at once, one mesh per task.
+void buildLodChains(std::vector<MeshData>& meshes, ThreadPool& pool, unsigned int levelCount = 4, float maxError = 0.05f);
+
+// Projected size in pixels of an object with the given bounding radius.
+float projectedScreenSize(float radius, float distance, float fovY, float viewportHeight);
+
+// Picks the coarsest level whose error, scaled by screenSize, stays under
+// pixelThreshold. Moving to a coarser level additionally needs a margin of
+// hysteresis so objects near a threshold do not flicker between levels.
+unsigned int selectLod(const std::vector<IndexRange>& lods, float screenSize, unsigned int currentLevel,
+    float pixelThreshold = 1.0f, float hysteresis = 0.25f);
+
+#endif
@@ -0,0 +1,90 @@
+#include "Mesh.h"
+#include "GpuMemory.h"
+#include <algorithm>
+
+GLenum meshIndexType(const MeshData& mesh)
+{
+    return mesh.vertices.size() <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+PrimitiveBuffers uploadMesh(const MeshData& mesh, VertexFormat format)
+{
+    PrimitiveBuffers buffers = {};
+    buffers.vertexCount = (unsigned int)mesh.vertices.size();
+    buffers.indexCount = mesh.lods.empty() ? (unsigned int)mesh.indices.size() : mesh.lods[0].count;
+    buffers.indexType = meshIndexType(mesh);
+    buffers.useEBO = !mesh.indices.empty();
+    buffers.format = format;
+
+    for (int k = 0; k < 3; ++k)
+    {
+        buffers.boundsMin[k] = mesh.vertices.empty() ? 0.0f : mesh.vertices[0].position[k];
+        buffers.boundsMax[k] = buffers.boundsMin[k];
+    }
+    for (const Vertex& v : mesh.vertices)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            buffers.boundsMin[k] = std::min(buffers.boundsMin[k], v.position[k]);
+            buffers.boundsMax[k] = std::max(buffers.boundsMax[k], v.position[k]);
+        }
+    }
+
+    glGenVertexArrays(1, &buffers.VAO);
+    glGenBuffers(1, &buffers.VBO);
+
+    std::vector<unsigned char> packed;
+    packVertices(mesh.vertices.data(), mesh.vertices.size(), format, packed);
+
+    glBindVertexArray(buffers.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.VBO);
+    glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+    GpuMemory::shared().record(GpuBuffer, buffers.VBO, GpuMemoryMeshes, packed.size());
+    setupVertexAttributes(format);
+
+    if (buffers.useEBO)
+    {
+        glGenBuffers(1, &buffers.EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.EBO);
+        if (buffers.indexType == GL_UNSIGNED_SHORT)
+        {
+            std::vector<unsigned short> shortIndices(mesh.indices.begin(), mesh.indices.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(unsigned short), shortIndices.data(), GL_STATIC_DRAW);
+            GpuMemory::shared().record(GpuBuffer, buffers.EBO, GpuMemoryMeshes, shortIndices.size() * sizeof(unsigned short));
+        }
+        else
+        {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+            GpuMemory::shared().record(GpuBuffer, buffers.EBO, GpuMemoryMeshes, mesh.indices.size() * sizeof(unsigned int));
+        }
+    }
+
+    glBindVertexArray(0);
+    return buffers;
+}
+
+void drawPrimitive(const PrimitiveBuffers& buffers)
+{
+    glBindVertexArray(buffers.VAO);
+    if (buffers.useEBO)
+        glDrawElements(GL_TRIANGLES, buffers.indexCount, buffers.indexType, 0);
+    else
+        glDrawArrays(GL_TRIANGLES, 0, buffers.vertexCount);
+}
+
+void drawPrimitiveRange(const PrimitiveBuffers& buffers, const IndexRange& range)
+{
+    size_t indexSize = buffers.indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    glBindVertexArray(buffers.VAO);
+    glDrawElements(GL_TRIANGLES, range.count, buffers.indexType, (void*)(range.first * indexSize));
+}
+
+void destroyPrimitive(PrimitiveBuffers& buffers)
+{
+    // The GPU may still be drawing from these this frame.
+    GpuResources& resources = GpuResources::shared();
+    resources.destroyDeferred(GpuVertexArray, buffers.VAO);
+    resources.destroyDeferred(GpuBuffer, buffers.VBO);
+    if (buffers.useEBO) resources.destroyDeferred(GpuBuffer, buffers.EBO);
+    buffers = {};
+}
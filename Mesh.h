@@ -0,0 +1,44 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glad/glad.h>
+#include "VertexFormat.h"
+#include <vector>
+
+enum PrimitiveShape { Triangle, Rectangle, Grid, Polygon, Circle, RoundedRectangle };
+
+struct PrimitiveBuffers {
+    unsigned int VAO;
+    unsigned int VBO;
+    unsigned int EBO;
+    bool useEBO;
+    unsigned int vertexCount;
+    unsigned int indexCount;
+    GLenum indexType;
+    VertexFormat format;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+struct IndexRange
+{
+    unsigned int first;
+    unsigned int count;
+    float error;
+};
+
+struct MeshData
+{
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<IndexRange> lods;   // empty, or one contiguous range per LOD
+};
+
+// GL_UNSIGNED_SHORT whenever every vertex is addressable with 16 bits.
+GLenum meshIndexType(const MeshData& mesh);
+PrimitiveBuffers uploadMesh(const MeshData& mesh, VertexFormat format);
+void drawPrimitive(const PrimitiveBuffers& buffers);
+void drawPrimitiveRange(const PrimitiveBuffers& buffers, const IndexRange& range);
+void destroyPrimitive(PrimitiveBuffers& buffers);
+
+#endif
@@ -0,0 +1,287 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+    VertexCacheStats stats = {};
+    if (indices.empty() || vertexCount == 0)
+        return stats;
+
+    // A vertex is in the cache when it entered within the last cacheSize misses.
+    std::vector<size_t> cacheStamp(vertexCount, 0);
+    size_t timestamp = cacheSize + 1;
+    size_t misses = 0;
+    for (unsigned int index : indices)
+    {
+        if (timestamp - cacheStamp[index] > cacheSize)
+        {
+            cacheStamp[index] = timestamp++;
+            ++misses;
+        }
+    }
+
+    stats.acmr = (float)misses / (float)(indices.size() / 3);
+    stats.atvr = (float)misses / (float)vertexCount;
+    return stats;
+}
+
+namespace
+{
+    const int forsythCacheSize = (int)vertexCacheSize;
+
+    float forsythVertexScore(int cachePosition, unsigned int remainingTriangles)
+    {
+        if (remainingTriangles == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+                score = 0.75f;
+            else
+                score = std::pow(1.0f - (float)(cachePosition - 3) / (forsythCacheSize - 3), 1.5f);
+        }
+        return score + 2.0f / std::sqrt((float)remainingTriangles);
+    }
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    std::vector<unsigned int> triangleOffsets(vertexCount + 1, 0);
+    for (unsigned int index : indices)
+        ++triangleOffsets[index + 1];
+    for (size_t v = 0; v < vertexCount; ++v)
+        triangleOffsets[v + 1] += triangleOffsets[v];
+
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+        adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+    std::vector<unsigned int> remaining(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        remaining[v] = triangleOffsets[v + 1] - triangleOffsets[v];
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+    std::vector<unsigned char> emitted(triangleCount, 0);
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    int cache[forsythCacheSize + 3];
+    int cacheCount = 0;
+    size_t scanCursor = 0;
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        // Best triangle touching the cache; fall back to the next unemitted one.
+        long best = -1;
+        float bestScore = -1.0f;
+        for (int c = 0; c < cacheCount; ++c)
+        {
+            unsigned int v = (unsigned int)cache[c];
+            for (unsigned int a = triangleOffsets[v]; a < triangleOffsets[v + 1]; ++a)
+            {
+                unsigned int t = adjacency[a];
+                if (!emitted[t] && triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = (long)t;
+                }
+            }
+        }
+        if (best < 0)
+        {
+            while (emitted[scanCursor]) ++scanCursor;
+            best = (long)scanCursor;
+        }
+
+        unsigned int tri = (unsigned int)best;
+        emitted[tri] = 1;
+        int newCache[forsythCacheSize + 3];
+        int newCount = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int v = indices[tri * 3 + k];
+            output.push_back(v);
+            newCache[newCount++] = (int)v;
+            --remaining[v];
+        }
+        for (int c = 0; c < cacheCount; ++c)
+        {
+            int v = cache[c];
+            if (v != newCache[0] && v != newCache[1] && v != newCache[2])
+                newCache[newCount++] = v;
+        }
+
+        for (int c = 0; c < newCount; ++c)
+        {
+            unsigned int v = (unsigned int)newCache[c];
+            cachePosition[v] = c < forsythCacheSize ? c : -1;
+            vertexScore[v] = forsythVertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // Rescore triangles around every vertex whose score just changed.
+        for (int c = 0; c < newCount; ++c)
+        {
+            unsigned int v = (unsigned int)newCache[c];
+            for (unsigned int a = triangleOffsets[v]; a < triangleOffsets[v + 1]; ++a)
+            {
+                unsigned int t = adjacency[a];
+                if (!emitted[t])
+                    triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+            }
+        }
+
+        cacheCount = std::min(newCount, forsythCacheSize);
+        std::copy(newCache, newCache + cacheCount, cache);
+    }
+
+    indices.swap(output);
+}
+
+void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, size_t minClusterTriangles)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Hard boundaries: a triangle that misses the cache on all three
+    // vertices starts a new region; tiny regions are merged forward.
+    const unsigned int cacheSize = vertexCacheSize;
+    std::vector<size_t> cacheStamp(vertices.size(), 0);
+    size_t timestamp = cacheSize + 1;
+    std::vector<size_t> clusterStarts(1, 0);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int v = indices[t * 3 + k];
+            if (timestamp - cacheStamp[v] > cacheSize)
+            {
+                cacheStamp[v] = timestamp++;
+                ++misses;
+            }
+        }
+        if (misses == 3 && t - clusterStarts.back() >= minClusterTriangles)
+            clusterStarts.push_back(t);
+    }
+    clusterStarts.push_back(triangleCount);
+    size_t clusterCount = clusterStarts.size() - 1;
+
+    // Sort key: how far the cluster sits out along its own average normal,
+    // measured from the area-weighted mesh centroid.
+    std::vector<float> clusterData(clusterCount * 6, 0.0f);
+    float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        float* centroid = &clusterData[c * 6];
+        float* normal = &clusterData[c * 6 + 3];
+        float area = 0.0f;
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+        {
+            const float* a = vertices[indices[t * 3]].position;
+            const float* b = vertices[indices[t * 3 + 1]].position;
+            const float* d = vertices[indices[t * 3 + 2]].position;
+            float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            float e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; ++k)
+            {
+                centroid[k] += (a[k] + b[k] + d[k]) * triangleArea / 3.0f;
+                normal[k] += n[k];
+            }
+            area += triangleArea;
+        }
+
+        for (int k = 0; k < 3; ++k)
+        {
+            meshCentroid[k] += centroid[k];
+            centroid[k] = area > 0.0f ? centroid[k] / area : 0.0f;
+        }
+        meshArea += area;
+
+        float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (int k = 0; k < 3; ++k)
+            normal[k] = length > 0.0f ? normal[k] / length : 0.0f;
+    }
+    for (int k = 0; k < 3; ++k)
+        meshCentroid[k] = meshArea > 0.0f ? meshCentroid[k] / meshArea : 0.0f;
+
+    std::vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        const float* centroid = &clusterData[c * 6];
+        const float* normal = &clusterData[c * 6 + 3];
+        sortKey[c] = (centroid[0] - meshCentroid[0]) * normal[0]
+                   + (centroid[1] - meshCentroid[1]) * normal[1]
+                   + (centroid[2] - meshCentroid[2]) * normal[2];
+    }
+
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (size_t c : order)
+        output.insert(output.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+    indices.swap(output);
+}
+
+void optimizeVertexFetch(MeshData& mesh)
+{
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(mesh.vertices.size(), unused);
+    std::vector<Vertex> reordered;
+    reordered.reserve(mesh.vertices.size());
+
+    for (unsigned int& index : mesh.indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = (unsigned int)reordered.size();
+            reordered.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    // Vertices no triangle references are dropped.
+    mesh.vertices.swap(reordered);
+}
+
+void optimizeMesh(MeshData& mesh, MeshOptimizationReport* report)
+{
+    size_t indexBytes = mesh.indices.size() * sizeof(unsigned int);
+    VertexCacheStats before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    optimizeOverdraw(mesh.indices, mesh.vertices);
+    optimizeVertexFetch(mesh);
+
+    if (report)
+    {
+        report->before = before;
+        report->after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+        report->indexBytesBefore = indexBytes;
+        report->indexBytesAfter = mesh.indices.size() * (meshIndexType(mesh) == GL_UNSIGNED_SHORT ? 2 : 4);
+    }
+}
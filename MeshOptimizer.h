@@ -0,0 +1,46 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "Mesh.h"
+#include <cstddef>
+#include <vector>
+
+struct VertexCacheStats
+{
+    float acmr;   // transformed vertices per triangle, 0.5 is ideal for grids
+    float atvr;   // transformed vertices per unique vertex, 1.0 is ideal
+};
+
+struct MeshOptimizationReport
+{
+    VertexCacheStats before;
+    VertexCacheStats after;
+    size_t indexBytesBefore;
+    size_t indexBytesAfter;
+};
+
+// Cache size the optimiser targets and the analysis simulates by default,
+// so the reported ACMR measures what was optimised for.
+const unsigned int vertexCacheSize = 32;
+
+// FIFO post-transform cache simulation, as on most current GPUs.
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount,
+    unsigned int cacheSize = vertexCacheSize);
+
+// Forsyth's linear-speed vertex cache optimisation.
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+// Splits the cache-ordered triangles into clusters where the cache restarts
+// and sorts those clusters outside-in so front-facing outer surfaces tend to
+// draw first. Run after optimizeVertexCache.
+void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, size_t minClusterTriangles = 32);
+
+// Reorders vertices by first use so vertex fetch walks memory linearly.
+void optimizeVertexFetch(MeshData& mesh);
+
+// Runs all three passes in order; use it before building LOD ranges.
+// Index size is chosen at upload time by meshIndexType(); the report
+// accounts for that.
+void optimizeMesh(MeshData& mesh, MeshOptimizationReport* report = nullptr);
+
+#endif
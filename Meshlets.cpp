@@ -0,0 +1,256 @@
+#include "Meshlets.h"
+#include "FrameArena.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    void computeBounds(const MeshData& mesh, Meshlet& meshlet)
+    {
+        const unsigned int* indices = &mesh.indices[meshlet.firstIndex];
+        size_t indexCount = meshlet.triangleCount * 3;
+
+        // Ritter's bounding sphere: start from two far apart points, then
+        // grow to include every vertex.
+        const float* p0 = mesh.vertices[indices[0]].position;
+        auto farthestFrom = [&](const float* from)
+        {
+            const float* best = from;
+            float bestDistance = -1.0f;
+            for (size_t i = 0; i < indexCount; ++i)
+            {
+                const float* p = mesh.vertices[indices[i]].position;
+                float dx = p[0] - from[0], dy = p[1] - from[1], dz = p[2] - from[2];
+                float distance = dx * dx + dy * dy + dz * dz;
+                if (distance > bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            return best;
+        };
+        const float* a = farthestFrom(p0);
+        const float* b = farthestFrom(a);
+        float center[3] = { 0.5f * (a[0] + b[0]), 0.5f * (a[1] + b[1]), 0.5f * (a[2] + b[2]) };
+        float dx = b[0] - a[0], dy = b[1] - a[1], dz = b[2] - a[2];
+        float radius = 0.5f * std::sqrt(dx * dx + dy * dy + dz * dz);
+        for (size_t i = 0; i < indexCount; ++i)
+        {
+            const float* p = mesh.vertices[indices[i]].position;
+            float ox = p[0] - center[0], oy = p[1] - center[1], oz = p[2] - center[2];
+            float distance = std::sqrt(ox * ox + oy * oy + oz * oz);
+            if (distance > radius)
+            {
+                float grow = 0.5f * (distance - radius);
+                radius += grow;
+                center[0] += ox / distance * grow;
+                center[1] += oy / distance * grow;
+                center[2] += oz / distance * grow;
+            }
+        }
+        std::copy(center, center + 3, meshlet.center);
+        meshlet.radius = radius;
+
+        std::vector<float> normals(meshlet.triangleCount * 3, 0.0f);
+        float axis[3] = { 0.0f, 0.0f, 0.0f };
+        for (unsigned int t = 0; t < meshlet.triangleCount; ++t)
+        {
+            const float* v0 = mesh.vertices[indices[t * 3]].position;
+            const float* v1 = mesh.vertices[indices[t * 3 + 1]].position;
+            const float* v2 = mesh.vertices[indices[t * 3 + 2]].position;
+            float e1[3] = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+            float e2[3] = { v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2] };
+            float* n = &normals[t * 3];
+            n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+            n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+            n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+            float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length > 0.0f)
+            {
+                n[0] /= length; n[1] /= length; n[2] /= length;
+            }
+            axis[0] += n[0]; axis[1] += n[1]; axis[2] += n[2];
+        }
+
+        float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        float minDot = 1.0f;
+        if (axisLength > 0.0f)
+        {
+            for (int k = 0; k < 3; ++k)
+                axis[k] /= axisLength;
+            for (unsigned int t = 0; t < meshlet.triangleCount; ++t)
+            {
+                const float* n = &normals[t * 3];
+                minDot = std::min(minDot, n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2]);
+            }
+        }
+        else
+        {
+            minDot = -1.0f;
+        }
+
+        std::copy(axis, axis + 3, meshlet.coneAxis);
+        meshlet.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+    }
+}
+
+std::vector<Meshlet> buildMeshlets(MeshData& mesh, unsigned int maxVertices, unsigned int maxTriangles)
+{
+    // A cluster must fit at least one triangle or it never makes progress.
+    maxVertices = std::max(maxVertices, 3u);
+    maxTriangles = std::max(maxTriangles, 1u);
+    size_t triangleCount = mesh.indices.size() / 3;
+    size_t vertexCount = mesh.vertices.size();
+
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (unsigned int index : mesh.indices)
+        ++offsets[index + 1];
+    for (size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] += offsets[v];
+    std::vector<unsigned int> adjacency(mesh.indices.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < mesh.indices.size(); ++i)
+        adjacency[fill[mesh.indices[i]]++] = (unsigned int)(i / 3);
+
+    std::vector<unsigned char> assigned(triangleCount, 0);
+    std::vector<unsigned int> usedBy(vertexCount, ~0u);
+    std::vector<unsigned int> output;
+    output.reserve(mesh.indices.size());
+    std::vector<Meshlet> meshlets;
+
+    size_t scanCursor = 0;
+    std::vector<unsigned int> meshletVertices;
+    while (output.size() < mesh.indices.size())
+    {
+        unsigned int id = (unsigned int)meshlets.size();
+        Meshlet meshlet = {};
+        meshlet.firstIndex = (unsigned int)output.size();
+        meshletVertices.clear();
+
+        auto newVertices = [&](size_t t)
+        {
+            unsigned int added = 0;
+            for (int k = 0; k < 3; ++k)
+                added += usedBy[mesh.indices[t * 3 + k]] != id;
+            return added;
+        };
+
+        while (meshlet.triangleCount < maxTriangles)
+        {
+            // Prefer the adjacent triangle that adds the fewest new vertices.
+            size_t best = triangleCount;
+            unsigned int bestAdded = 4;
+            for (unsigned int v : meshletVertices)
+            {
+                for (unsigned int a = offsets[v]; a < offsets[v + 1] && bestAdded > 0; ++a)
+                {
+                    unsigned int t = adjacency[a];
+                    if (assigned[t]) continue;
+                    unsigned int added = newVertices(t);
+                    if (added < bestAdded)
+                    {
+                        bestAdded = added;
+                        best = t;
+                    }
+                }
+                if (bestAdded == 0) break;
+            }
+            if (best == triangleCount)
+            {
+                while (scanCursor < triangleCount && assigned[scanCursor]) ++scanCursor;
+                if (scanCursor == triangleCount) break;
+                best = scanCursor;
+                bestAdded = newVertices(best);
+            }
+            if (meshletVertices.size() + bestAdded > maxVertices)
+                break;
+
+            assigned[best] = 1;
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int v = mesh.indices[best * 3 + k];
+                if (usedBy[v] != id)
+                {
+                    usedBy[v] = id;
+                    meshletVertices.push_back(v);
+                }
+                output.push_back(v);
+            }
+            ++meshlet.triangleCount;
+        }
+        meshlets.push_back(meshlet);
+    }
+
+    mesh.indices.swap(output);
+    for (Meshlet& meshlet : meshlets)
+        computeBounds(mesh, meshlet);
+    return meshlets;
+}
+
+static bool meshletVisible(const Meshlet& m, const Frustum& frustum, const float* camera)
+{
+    float toCenter[3] = { m.center[0] - camera[0], m.center[1] - camera[1], m.center[2] - camera[2] };
+    float distance = std::sqrt(toCenter[0] * toCenter[0] + toCenter[1] * toCenter[1] + toCenter[2] * toCenter[2]);
+    float facing = toCenter[0] * m.coneAxis[0] + toCenter[1] * m.coneAxis[1] + toCenter[2] * m.coneAxis[2];
+    if (m.coneCutoff < 1.0f && facing >= m.coneCutoff * distance + m.radius)
+        return false;
+
+    for (int p = 0; p < 6; ++p)
+    {
+        const float* plane = frustum.planes[p];
+        float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        float d = plane[0] * m.center[0] + plane[1] * m.center[1] + plane[2] * m.center[2] + plane[3];
+        if (d < -m.radius * length)
+            return false;
+    }
+    return true;
+}
+
+void cullMeshlets(const std::vector<Meshlet>& meshlets, const Frustum& frustum, const float cameraPosition[3],
+    GLenum indexType, MeshletDrawList& drawList, ThreadPool* pool)
+{
+    FrameVector<unsigned char> visible(meshlets.size());
+    auto testRange = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            visible[i] = meshletVisible(meshlets[i], frustum, cameraPosition) ? 1 : 0;
+    };
+    if (pool)
+        pool->parallelFor(meshlets.size(), testRange, 256);
+    else
+        testRange(0, meshlets.size());
+
+    drawList.counts.clear();
+    drawList.offsets.clear();
+    drawList.baseVertices.clear();
+
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    size_t rangeEnd = ~(size_t)0;
+    for (size_t i = 0; i < meshlets.size(); ++i)
+    {
+        if (!visible[i])
+            continue;
+        const Meshlet& m = meshlets[i];
+        if (m.firstIndex == rangeEnd)
+        {
+            drawList.counts.back() += (GLsizei)(m.triangleCount * 3);
+        }
+        else
+        {
+            drawList.counts.push_back((GLsizei)(m.triangleCount * 3));
+            drawList.offsets.push_back((const void*)(m.firstIndex * indexSize));
+            drawList.baseVertices.push_back(0);
+        }
+        rangeEnd = m.firstIndex + m.triangleCount * 3;
+    }
+}
+
+void drawMeshlets(const PrimitiveBuffers& buffers, const MeshletDrawList& drawList)
+{
+    if (drawList.counts.empty())
+        return;
+    glBindVertexArray(buffers.VAO);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawList.counts.data(), buffers.indexType,
+        drawList.offsets.data(), (GLsizei)drawList.counts.size(), drawList.baseVertices.data());
+}
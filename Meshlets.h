@@ -0,0 +1,41 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include "Culling.h"
+#include "Mesh.h"
+#include "ThreadPool.h"
+#include <vector>
+
+struct Meshlet
+{
+    unsigned int firstIndex;
+    unsigned int triangleCount;
+    float center[3];
+    float radius;
+    float coneAxis[3];
+    float coneCutoff;   // sine of the cone's half angle; 1 disables cone culling
+};
+
+// Reorders mesh.indices so each cluster of at most maxVertices unique
+// vertices and maxTriangles triangles is contiguous, growing clusters
+// through shared vertices. Run on an index buffer without LOD ranges.
+// The limits are clamped to at least 3 vertices and 1 triangle.
+std::vector<Meshlet> buildMeshlets(MeshData& mesh, unsigned int maxVertices = 64, unsigned int maxTriangles = 124);
+
+// Draw lists for glMultiDrawElementsBaseVertex. Neighbouring surviving
+// clusters are merged into a single range.
+struct MeshletDrawList
+{
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    std::vector<GLint> baseVertices;
+};
+
+// cameraPosition and frustum are in the mesh's model space. Clusters facing
+// away from the camera or outside the frustum are dropped.
+void cullMeshlets(const std::vector<Meshlet>& meshlets, const Frustum& frustum, const float cameraPosition[3],
+    GLenum indexType, MeshletDrawList& drawList, ThreadPool* pool = nullptr);
+
+void drawMeshlets(const PrimitiveBuffers& buffers, const MeshletDrawList& drawList);
+
+#endif
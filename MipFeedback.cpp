@@ -0,0 +1,185 @@
+#include "MipFeedback.h"
+#include "GpuMemory.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+MipFeedback::MipFeedback(int targetWidth, int targetHeight, unsigned int frameInterval, ThreadPool* threadPool)
+    : shader("3.3.shader.vs", "3.3.feedback.fs"),
+      width(targetWidth), height(targetHeight), interval(std::max(frameInterval, 1u)), pool(threadPool),
+      latest(std::make_shared<Reduction>())
+{
+    target = TextureObject::create();
+    glBindTexture(GL_TEXTURE_2D, target.id());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16UI, width, height, 0, GL_RG_INTEGER, GL_UNSIGNED_SHORT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    GpuMemory::shared().record(GpuTexture, target.id(), GpuMemoryOther, (size_t)width * height * 4);
+
+    depthBuffer = RenderbufferObject::create();
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer.id());
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    GpuMemory::shared().record(GpuRenderbuffer, depthBuffer.id(), GpuMemoryOther, (size_t)width * height * 4);
+
+    framebuffer = FramebufferObject::create();
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.id());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.id(), 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer.id());
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FEEDBACK::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (Readback& readback : readbacks)
+    {
+        readback.pixels = BufferObject::create();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixels.id());
+        glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)width * height * 4, NULL, GL_STREAM_READ);
+        GpuMemory::shared().record(GpuBuffer, readback.pixels.id(), GpuMemoryOther, (size_t)width * height * 4);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    textureIdLocation = glGetUniformLocation(shader.id(), "textureId");
+    textureExtentLocation = glGetUniformLocation(shader.id(), "textureExtent");
+}
+
+MipFeedback::~MipFeedback()
+{
+    for (Readback& readback : readbacks)
+    {
+        if (readback.fence)
+            glDeleteSync(readback.fence);
+    }
+}
+
+bool MipFeedback::begin(int screenWidth)
+{
+    if (frame++ % interval != 0)
+        return false;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.id());
+    glViewport(0, 0, width, height);
+    const GLuint clear[4] = { NoTexture, NoTexture, 0, 0 };
+    glClearBufferuiv(GL_COLOR, 0, clear);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    depthTestWasEnabled = glIsEnabled(GL_DEPTH_TEST) == GL_TRUE;
+    glEnable(GL_DEPTH_TEST);
+
+    // Derivatives here span screenWidth / width screen pixels; bias the
+    // level back to what the full-resolution pass would pick.
+    shader.use();
+    shader.setFloat("mipBias", std::log2((float)width / std::max(screenWidth, 1)));
+    return true;
+}
+
+void MipFeedback::setTexture(unsigned int textureId, int textureWidth, int textureHeight)
+{
+    glUniform1ui(textureIdLocation, textureId);
+    glUniform2f(textureExtentLocation, (float)textureWidth, (float)textureHeight);
+}
+
+void MipFeedback::end(int screenWidth, int screenHeight)
+{
+    // Skip the readback if this PBO's previous one is still in flight.
+    Readback& readback = readbacks[nextReadback];
+    if (!readback.fence)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixels.id());
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glReadPixels(0, 0, width, height, GL_RG_INTEGER, GL_UNSIGNED_SHORT, (void*)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        nextReadback ^= 1;
+    }
+
+    if (!depthTestWasEnabled)
+        glDisable(GL_DEPTH_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, screenWidth, screenHeight);
+}
+
+void MipFeedback::reduce(const std::vector<unsigned short>& pixels, std::vector<unsigned char>& minLevels)
+{
+    minLevels.clear();
+    for (size_t i = 0; i + 1 < pixels.size(); i += 2)
+    {
+        unsigned short id = pixels[i];
+        if (id == NoTexture)
+            continue;
+        if (id >= minLevels.size())
+            minLevels.resize((size_t)id + 1, 0xFF);
+        minLevels[id] = std::min(minLevels[id], (unsigned char)pixels[i + 1]);
+    }
+}
+
+void MipFeedback::collect()
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        // Oldest first, so results are handed to the pool in order.
+        Readback& readback = readbacks[(nextReadback + i) & 1];
+        if (!readback.fence)
+            continue;
+        GLenum status = glClientWaitSync(readback.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        glDeleteSync(readback.fence);
+        readback.fence = 0;
+
+        size_t count = (size_t)width * height * 2;
+        std::shared_ptr<std::vector<unsigned short>> pixels = std::make_shared<std::vector<unsigned short>>(count);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixels.id());
+        void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, count * sizeof(unsigned short), GL_MAP_READ_BIT);
+        if (mapped)
+        {
+            memcpy(pixels->data(), mapped, count * sizeof(unsigned short));
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (!mapped)
+            continue;
+
+        std::shared_ptr<Reduction> reduction = latest;
+        unsigned int sequence = ++readbackSequence;
+        pool->enqueue([pixels, reduction, sequence]() {
+            std::vector<unsigned char> minLevels;
+            reduce(*pixels, minLevels);
+            std::lock_guard<std::mutex> lock(reduction->mutex);
+            if (sequence > reduction->sequence)
+            {
+                reduction->minLevels.swap(minLevels);
+                reduction->sequence = sequence;
+                reduction->fresh = true;
+            }
+        });
+    }
+}
+
+bool MipFeedback::takeResult(std::vector<unsigned char>& minLevels)
+{
+    std::lock_guard<std::mutex> lock(latest->mutex);
+    if (!latest->fresh)
+        return false;
+    minLevels = latest->minLevels;
+    latest->fresh = false;
+    return true;
+}
+
+ResidencyManager::ResidencyManager(TextureStreamer& textureStreamer, MipFeedback& mipFeedback)
+    : streamer(textureStreamer), feedback(mipFeedback)
+{
+}
+
+void ResidencyManager::update()
+{
+    feedback.collect();
+    if (!feedback.takeResult(minLevels))
+        return;
+
+    for (size_t stream = 0; stream < streamer.size(); ++stream)
+    {
+        unsigned char level = stream < minLevels.size() ? minLevels[stream] : 0xFF;
+        streamer.setRequiredLevel(stream, level == 0xFF ? INT_MAX : (int)level);
+    }
+}
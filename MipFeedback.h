@@ -0,0 +1,99 @@
+#ifndef MIP_FEEDBACK_H
+#define MIP_FEEDBACK_H
+
+#include <glad/glad.h>
+#include "GpuResources.h"
+#include "Shader.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Low-resolution pass that records, per pixel, which texture is visible
+// and the finest mip level it needs (3.3.feedback.fs into an RG16UI
+// target). The target is read back into one of two PBOs and picked up a
+// few frames later without stalling; a worker reduces it to the finest
+// level seen per texture id.
+class MipFeedback
+{
+public:
+    MipFeedback(int width, int height, unsigned int interval = 4, ThreadPool* pool = &ThreadPool::shared());
+    ~MipFeedback();
+
+    MipFeedback(const MipFeedback&) = delete;
+    MipFeedback& operator=(const MipFeedback&) = delete;
+
+    // Returns false on frames the pass is skipped. Otherwise binds the
+    // feedback target and program; draw the scene with setTexture() before
+    // each draw, then call end().
+    bool begin(int screenWidth);
+    void setTexture(unsigned int textureId, int width, int height);
+    void end(int screenWidth, int screenHeight);
+
+    // Starts reductions for readbacks the GPU has finished. Call every frame.
+    void collect();
+
+    // Finest level needed per texture id, 0xFF where a texture was not
+    // seen. Returns false if nothing new arrived since the last call.
+    bool takeResult(std::vector<unsigned char>& minLevels);
+
+    static const unsigned short NoTexture = 0xFFFF;
+
+private:
+    struct Readback
+    {
+        BufferObject pixels;
+        GLsync fence = 0;
+    };
+
+    static void reduce(const std::vector<unsigned short>& pixels, std::vector<unsigned char>& minLevels);
+
+    Shader shader;
+    int width;
+    int height;
+    unsigned int interval;
+    unsigned int frame = 0;
+    ThreadPool* pool;
+
+    FramebufferObject framebuffer;
+    RenderbufferObject depthBuffer;
+    TextureObject target;
+    GLint textureIdLocation = -1;
+    GLint textureExtentLocation = -1;
+    Readback readbacks[2];
+    int nextReadback = 0;
+
+    bool depthTestWasEnabled = false;
+
+    // Shared with reduction tasks, which may outlive this object.
+    struct Reduction
+    {
+        std::mutex mutex;
+        std::vector<unsigned char> minLevels;
+        unsigned int sequence = 0;
+        bool fresh = false;
+    };
+    std::shared_ptr<Reduction> latest;
+    unsigned int readbackSequence = 0;
+};
+
+// Turns feedback into required levels for a TextureStreamer, whose stream
+// indices double as feedback texture ids. Textures not seen fall back to
+// their mip tail.
+class ResidencyManager
+{
+public:
+    ResidencyManager(TextureStreamer& streamer, MipFeedback& feedback);
+
+    // Collects feedback and updates the streamer; call once per frame
+    // before TextureStreamer::update().
+    void update();
+
+private:
+    TextureStreamer& streamer;
+    MipFeedback& feedback;
+    std::vector<unsigned char> minLevels;
+};
+
+#endif
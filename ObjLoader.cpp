@@ -0,0 +1,377 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+namespace
+{
+    struct ObjCorner
+    {
+        int32_t index[3];      // position, texcoord, normal; 0 when absent
+        uint8_t relative;      // bit set: index is chunk-local, fix up later
+        uint8_t present;       // bit set: component was given
+    };
+
+    struct ObjChunk
+    {
+        std::vector<float> positions;
+        std::vector<float> texCoords;
+        std::vector<float> normals;
+        std::vector<ObjCorner> corners;
+        size_t positionBase = 0;
+        size_t texCoordBase = 0;
+        size_t normalBase = 0;
+        bool failed = false;
+    };
+
+    inline bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline const char* skipSpaces(const char* p, const char* end)
+    {
+        while (p < end && isSpace(*p)) ++p;
+        return p;
+    }
+
+    inline const char* skipLine(const char* p, const char* end)
+    {
+        while (p < end && *p != '\n') ++p;
+        return p < end ? p + 1 : end;
+    }
+
+    const double powersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    // Locale independent and much faster than strtof; good to float precision.
+    const char* parseFloat(const char* p, const char* end, float& out)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+
+        uint64_t mantissa = 0;
+        int exponent = 0;
+        int digits = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+        {
+            if (digits < 19) mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            else ++exponent;
+        }
+        if (p < end && *p == '.')
+        {
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p)
+            {
+                if (digits++ < 19)
+                {
+                    mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                    --exponent;
+                }
+            }
+        }
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            ++p;
+            bool negativeExponent = false;
+            if (p < end && (*p == '-' || *p == '+'))
+                negativeExponent = *p++ == '-';
+            int value = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; ++p)
+                value = std::min(value * 10 + (*p - '0'), 1000);
+            exponent += negativeExponent ? -value : value;
+        }
+
+        double result = (double)mantissa;
+        while (exponent > 22) { result *= 1e22; exponent -= 22; }
+        while (exponent < -22) { result /= 1e22; exponent += 22; }
+        result = exponent >= 0 ? result * powersOfTen[exponent] : result / powersOfTen[-exponent];
+        out = (float)(negative ? -result : result);
+        return p;
+    }
+
+    const char* parseInt(const char* p, const char* end, int32_t& out, bool& ok)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        int64_t value = 0;
+        const char* start = p;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+            value = std::min<int64_t>(value * 10 + (*p - '0'), INT32_MAX);
+        ok = p != start;
+        out = (int32_t)(negative ? -value : value);
+        return p;
+    }
+
+    const char* parseFloats(const char* p, const char* end, std::vector<float>& out, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            p = skipSpaces(p, end);
+            float value = 0.0f;
+            p = parseFloat(p, end, value);
+            out.push_back(value);
+        }
+        return p;
+    }
+
+    bool parseCorner(const char*& p, const char* end, const ObjChunk& chunk, ObjCorner& corner)
+    {
+        const size_t localCounts[3] = {
+            chunk.positions.size() / 3, chunk.texCoords.size() / 2, chunk.normals.size() / 3
+        };
+        corner = {};
+        for (int component = 0; component < 3; ++component)
+        {
+            if (component > 0)
+            {
+                if (p >= end || *p != '/')
+                    break;
+                ++p;
+                if (p < end && *p == '/')
+                    continue;
+            }
+            int32_t value = 0;
+            bool ok = false;
+            p = parseInt(p, end, value, ok);
+            if (!ok || value == 0)
+                return component > 0;
+
+            corner.present |= (uint8_t)(1 << component);
+            if (value > 0)
+            {
+                corner.index[component] = value - 1;
+            }
+            else
+            {
+                corner.index[component] = (int32_t)localCounts[component] + value;
+                corner.relative |= (uint8_t)(1 << component);
+            }
+        }
+        return (corner.present & 1) != 0;
+    }
+
+    void parseChunk(const char* p, const char* end, ObjChunk& chunk)
+    {
+        while (p < end)
+        {
+            p = skipSpaces(p, end);
+            if (p >= end)
+                break;
+
+            if (p[0] == 'v' && p + 1 < end)
+            {
+                if (isSpace(p[1]))
+                    p = parseFloats(p + 2, end, chunk.positions, 3);
+                else if (p[1] == 't')
+                    p = parseFloats(p + 2, end, chunk.texCoords, 2);
+                else if (p[1] == 'n')
+                    p = parseFloats(p + 2, end, chunk.normals, 3);
+            }
+            else if (p[0] == 'f' && p + 1 < end && isSpace(p[1]))
+            {
+                // Fan triangulation only needs the first and the previous
+                // corner, so faces of any size stream straight out.
+                int cornerCount = 0;
+                ObjCorner first = {}, previous = {};
+                const char* q = p + 2;
+                for (;;)
+                {
+                    q = skipSpaces(q, end);
+                    if (q >= end || *q == '\n' || *q == '#')
+                        break;
+                    ObjCorner corner;
+                    if (!parseCorner(q, end, chunk, corner))
+                    {
+                        chunk.failed = true;
+                        break;
+                    }
+                    if (cornerCount == 0)
+                        first = corner;
+                    else if (cornerCount >= 2)
+                    {
+                        chunk.corners.push_back(first);
+                        chunk.corners.push_back(previous);
+                        chunk.corners.push_back(corner);
+                    }
+                    previous = corner;
+                    ++cornerCount;
+                }
+                p = q;
+            }
+            p = skipLine(p, end);
+        }
+    }
+
+    inline uint32_t hashCorner(const int32_t* key)
+    {
+        uint32_t h = (uint32_t)key[0] * 0x9e3779b1u;
+        h ^= (uint32_t)key[1] * 0x85ebca77u;
+        h ^= (uint32_t)key[2] * 0xc2b2ae3du;
+        h ^= h >> 16;
+        h *= 0x7feb352du;
+        h ^= h >> 15;
+        return h;
+    }
+}
+
+bool parseObj(const char* text, size_t size, MeshData& mesh, ThreadPool& pool)
+{
+    const size_t minChunkBytes = 1 << 20;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(size / minChunkBytes, (pool.workerCount() + 1) * 4));
+
+    std::vector<size_t> bounds(chunkCount + 1, size);
+    bounds[0] = 0;
+    for (size_t i = 1; i < chunkCount; ++i)
+    {
+        size_t at = std::max(size * i / chunkCount, bounds[i - 1]);
+        while (at < size && text[at - 1] != '\n') ++at;
+        bounds[i] = at;
+    }
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    pool.parallelFor(chunkCount, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            parseChunk(text + bounds[i], text + bounds[i + 1], chunks[i]);
+    });
+
+    size_t positionCount = 0, texCoordCount = 0, normalCount = 0, cornerCount = 0;
+    for (ObjChunk& chunk : chunks)
+    {
+        if (chunk.failed)
+        {
+            std::cout << "ERROR::OBJ::MALFORMED_FACE" << std::endl;
+            return false;
+        }
+        chunk.positionBase = positionCount;
+        chunk.texCoordBase = texCoordCount;
+        chunk.normalBase = normalCount;
+        positionCount += chunk.positions.size() / 3;
+        texCoordCount += chunk.texCoords.size() / 2;
+        normalCount += chunk.normals.size() / 3;
+        cornerCount += chunk.corners.size();
+    }
+
+    std::vector<float> positions(positionCount * 3), texCoords(texCoordCount * 2), normals(normalCount * 3);
+    std::vector<int32_t> keys(cornerCount * 3);
+    std::vector<size_t> cornerBase(chunkCount, 0);
+    for (size_t i = 1; i < chunkCount; ++i)
+        cornerBase[i] = cornerBase[i - 1] + chunks[i - 1].corners.size();
+
+    const size_t limits[3] = { positionCount, texCoordCount, normalCount };
+    std::vector<unsigned char> chunkValid(chunkCount, 1);
+    pool.parallelFor(chunkCount, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const ObjChunk& chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase * 3);
+            std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + chunk.texCoordBase * 2);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase * 3);
+
+            const size_t bases[3] = { chunk.positionBase, chunk.texCoordBase, chunk.normalBase };
+            int32_t* out = &keys[cornerBase[i] * 3];
+            for (const ObjCorner& corner : chunk.corners)
+            {
+                for (int c = 0; c < 3; ++c, ++out)
+                {
+                    if (!(corner.present & (1 << c)))
+                    {
+                        *out = -1;
+                        continue;
+                    }
+                    int64_t index = corner.index[c];
+                    if (corner.relative & (1 << c))
+                        index += (int64_t)bases[c];
+                    if (index < 0 || index >= (int64_t)limits[c])
+                    {
+                        chunkValid[i] = 0;
+                        index = 0;
+                    }
+                    *out = (int32_t)index;
+                }
+            }
+        }
+    });
+
+    if (std::find(chunkValid.begin(), chunkValid.end(), 0) != chunkValid.end())
+    {
+        std::cout << "ERROR::OBJ::INDEX_OUT_OF_RANGE" << std::endl;
+        return false;
+    }
+
+    // Open addressing with linear probing; slots hold vertex index + 1.
+    size_t capacity = 16;
+    while (capacity < cornerCount * 2) capacity <<= 1;
+    std::vector<uint32_t> slots(capacity, 0);
+    std::vector<uint32_t> vertexKeys;
+    vertexKeys.reserve(cornerCount);
+
+    mesh.vertices.clear();
+    mesh.indices.resize(cornerCount);
+    for (size_t i = 0; i < cornerCount; ++i)
+    {
+        const int32_t* key = &keys[i * 3];
+        size_t slot = hashCorner(key) & (capacity - 1);
+        for (;;)
+        {
+            uint32_t entry = slots[slot];
+            if (entry == 0)
+            {
+                uint32_t vertexIndex = (uint32_t)mesh.vertices.size();
+                slots[slot] = vertexIndex + 1;
+                vertexKeys.push_back((uint32_t)i);
+
+                Vertex v = {};
+                std::copy(&positions[key[0] * 3], &positions[key[0] * 3] + 3, v.position);
+                if (key[1] >= 0)
+                    std::copy(&texCoords[key[1] * 2], &texCoords[key[1] * 2] + 2, v.texCoord);
+                for (int c = 0; c < 3; ++c)
+                    v.color[c] = key[2] >= 0 ? normals[key[2] * 3 + c] * 0.5f + 0.5f : 1.0f;
+                mesh.vertices.push_back(v);
+                mesh.indices[i] = vertexIndex;
+                break;
+            }
+            const int32_t* existing = &keys[vertexKeys[entry - 1] * 3];
+            if (existing[0] == key[0] && existing[1] == key[1] && existing[2] == key[2])
+            {
+                mesh.indices[i] = entry - 1;
+                break;
+            }
+            slot = (slot + 1) & (capacity - 1);
+        }
+    }
+    return true;
+}
+
+bool loadObj(const char* path, MeshData& mesh, MeshImportStats* stats, bool optimize)
+{
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file(path);
+    if (!file.isOpen())
+    {
+        std::cout << "ERROR::OBJ::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return false;
+    }
+
+    bool ok = parseObj((const char*)file.data(), file.size(), mesh);
+    MeshOptimizationReport optimization = {};
+    if (ok && optimize)
+        optimizeMesh(mesh, &optimization);
+
+    if (stats)
+    {
+        stats->optimization = optimization;
+        stats->bytes = file.size();
+        stats->uniqueVertices = mesh.vertices.size();
+        stats->triangles = mesh.indices.size() / 3;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return ok;
+}
@@ -0,0 +1,26 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+#include <cstddef>
+
+struct MeshImportStats
+{
+    size_t bytes;
+    size_t uniqueVertices;
+    size_t triangles;
+    double seconds;
+    MeshOptimizationReport optimization;
+};
+
+// Wavefront OBJ import. The file is memory-mapped and split into line
+// aligned chunks that parse in parallel; identical (v, vt, vn) corners are
+// merged into one vertex through an open-addressing hash table. Normals are
+// stored in the vertex color as n * 0.5 + 0.5 since Vertex has no normal.
+// With optimize set, the result also goes through optimizeMesh().
+bool loadObj(const char* path, MeshData& mesh, MeshImportStats* stats = nullptr, bool optimize = true);
+bool parseObj(const char* text, size_t size, MeshData& mesh, ThreadPool& pool = ThreadPool::shared());
+
+#endif
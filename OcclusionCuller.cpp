@@ -0,0 +1,286 @@
+#include "OcclusionCuller.h"
+#include "FrameArena.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+OcclusionCuller::OcclusionCuller(int w, int h)
+{
+    tilesX = std::max(1, (w + tileSize - 1) / tileSize);
+    tilesY = std::max(1, (h + tileSize - 1) / tileSize);
+    width = tilesX * tileSize;
+    height = tilesY * tileSize;
+    tileBins.resize((size_t)tilesX * tilesY);
+
+    int levelW = width, levelH = height;
+    for (;;)
+    {
+        pyramid.push_back(std::vector<float>((size_t)levelW * levelH, 1.0f));
+        levelWidth.push_back(levelW);
+        levelHeight.push_back(levelH);
+        if (levelW == 1 && levelH == 1)
+            break;
+        // Round up so an odd edge keeps its last column or row; texel x of
+        // a level then covers exactly texels 2x and 2x+1 of the one below.
+        levelW = (levelW + 1) / 2;
+        levelH = (levelH + 1) / 2;
+    }
+
+    std::fill(viewProjection, viewProjection + 16, 0.0f);
+    viewProjection[0] = viewProjection[5] = viewProjection[10] = viewProjection[15] = 1.0f;
+}
+
+void OcclusionCuller::beginFrame(const float* matrix)
+{
+    std::copy(matrix, matrix + 16, viewProjection);
+    triangles.clear();
+    for (std::vector<unsigned int>& bin : tileBins)
+        bin.clear();
+    std::fill(pyramid[0].begin(), pyramid[0].end(), 1.0f);
+}
+
+void OcclusionCuller::addOccluder(const float* positions, size_t strideBytes, const unsigned int* indices, size_t indexCount)
+{
+    const float* m = viewProjection;
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        ScreenTriangle tri;
+        bool behindNear = false;
+        for (int k = 0; k < 3; ++k)
+        {
+            const float* p = (const float*)((const unsigned char*)positions + indices[i + k] * strideBytes);
+            float cx = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+            float cy = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+            float cz = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+            float cw = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+            if (cw <= 1e-5f)
+            {
+                behindNear = true;
+                break;
+            }
+            float invW = 1.0f / cw;
+            tri.x[k] = (cx * invW * 0.5f + 0.5f) * width;
+            tri.y[k] = (cy * invW * 0.5f + 0.5f) * height;
+            tri.z[k] = std::min(std::max(cz * invW * 0.5f + 0.5f, 0.0f), 1.0f);
+        }
+        if (behindNear)
+            continue;
+
+        float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+        if (std::fabs(area) < 1e-6f)
+            continue;
+        if (area < 0.0f)
+        {
+            std::swap(tri.x[1], tri.x[2]);
+            std::swap(tri.y[1], tri.y[2]);
+            std::swap(tri.z[1], tri.z[2]);
+        }
+
+        float minX = std::min({ tri.x[0], tri.x[1], tri.x[2] });
+        float maxX = std::max({ tri.x[0], tri.x[1], tri.x[2] });
+        float minY = std::min({ tri.y[0], tri.y[1], tri.y[2] });
+        float maxY = std::max({ tri.y[0], tri.y[1], tri.y[2] });
+        if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+            continue;
+
+        tri.minTileX = std::max(0, (int)minX / tileSize);
+        tri.minTileY = std::max(0, (int)minY / tileSize);
+        tri.maxTileX = std::min(tilesX - 1, (int)maxX / tileSize);
+        tri.maxTileY = std::min(tilesY - 1, (int)maxY / tileSize);
+
+        unsigned int index = (unsigned int)triangles.size();
+        triangles.push_back(tri);
+        for (int ty = tri.minTileY; ty <= tri.maxTileY; ++ty)
+            for (int tx = tri.minTileX; tx <= tri.maxTileX; ++tx)
+                tileBins[(size_t)ty * tilesX + tx].push_back(index);
+    }
+}
+
+void OcclusionCuller::rasterizeTile(int tileX, int tileY)
+{
+    float* depth = pyramid[0].data();
+    int x0 = tileX * tileSize, y0 = tileY * tileSize;
+
+    for (unsigned int index : tileBins[(size_t)tileY * tilesX + tileX])
+    {
+        const ScreenTriangle& t = triangles[index];
+
+        // Edge i is opposite vertex i: E(px, py) = A * px + B * py + C.
+        float A[3], B[3], C[3];
+        for (int e = 0; e < 3; ++e)
+        {
+            int a = (e + 1) % 3, b = (e + 2) % 3;
+            A[e] = t.y[a] - t.y[b];
+            B[e] = t.x[b] - t.x[a];
+            C[e] = t.x[a] * t.y[b] - t.x[b] * t.y[a];
+        }
+        float invArea = 1.0f / (A[0] * t.x[0] + B[0] * t.y[0] + C[0]);
+
+        int minX = std::max(x0, (int)std::floor(std::min({ t.x[0], t.x[1], t.x[2] })));
+        int maxX = std::min(x0 + tileSize - 1, (int)std::ceil(std::max({ t.x[0], t.x[1], t.x[2] })));
+        int minY = std::max(y0, (int)std::floor(std::min({ t.y[0], t.y[1], t.y[2] })));
+        int maxY = std::min(y0 + tileSize - 1, (int)std::ceil(std::max({ t.y[0], t.y[1], t.y[2] })));
+        if (minX > maxX || minY > maxY)
+            continue;
+        minX &= ~3;
+
+        for (int py = minY; py <= maxY; ++py)
+        {
+            float fy = py + 0.5f;
+            float* row = depth + (size_t)py * width;
+            int px = minX;
+#if defined(SIMD_SSE2)
+            const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const __m128 zero = _mm_setzero_ps();
+            for (; px <= maxX; px += 4)
+            {
+                __m128 fx = _mm_add_ps(_mm_set1_ps((float)px), laneOffsets);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[0]), fx), _mm_set1_ps(B[0] * fy + C[0]));
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[1]), fx), _mm_set1_ps(B[1] * fy + C[1]));
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[2]), fx), _mm_set1_ps(B[2] * fy + C[2]));
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+
+                __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e0, _mm_set1_ps(t.z[0])), _mm_mul_ps(e1, _mm_set1_ps(t.z[1]))),
+                    _mm_mul_ps(e2, _mm_set1_ps(t.z[2])));
+                z = _mm_mul_ps(z, _mm_set1_ps(invArea));
+                __m128 old = _mm_loadu_ps(row + px);
+                __m128 nearer = _mm_min_ps(old, z);
+                _mm_storeu_ps(row + px, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+            }
+#else
+            for (; px <= maxX; ++px)
+            {
+                float fx = px + 0.5f;
+                float e0 = A[0] * fx + B[0] * fy + C[0];
+                float e1 = A[1] * fx + B[1] * fy + C[1];
+                float e2 = A[2] * fx + B[2] * fy + C[2];
+                if (e0 < 0.0f || e1 < 0.0f || e2 < 0.0f)
+                    continue;
+                float z = (e0 * t.z[0] + e1 * t.z[1] + e2 * t.z[2]) * invArea;
+                row[px] = std::min(row[px], z);
+            }
+#endif
+        }
+    }
+}
+
+void OcclusionCuller::buildPyramid()
+{
+    // Each texel keeps the farthest depth of the 2x2 block below it, so a
+    // box nearer than that texel is potentially visible. On an odd edge the
+    // block is clamped and the last source texel is folded in on its own.
+    for (size_t level = 1; level < pyramid.size(); ++level)
+    {
+        const std::vector<float>& src = pyramid[level - 1];
+        std::vector<float>& dst = pyramid[level];
+        int srcW = levelWidth[level - 1], srcH = levelHeight[level - 1];
+        int dstW = levelWidth[level], dstH = levelHeight[level];
+        for (int y = 0; y < dstH; ++y)
+        {
+            int sy0 = std::min(y * 2, srcH - 1), sy1 = std::min(y * 2 + 1, srcH - 1);
+            for (int x = 0; x < dstW; ++x)
+            {
+                int sx0 = std::min(x * 2, srcW - 1), sx1 = std::min(x * 2 + 1, srcW - 1);
+                dst[(size_t)y * dstW + x] = std::max(
+                    std::max(src[(size_t)sy0 * srcW + sx0], src[(size_t)sy0 * srcW + sx1]),
+                    std::max(src[(size_t)sy1 * srcW + sx0], src[(size_t)sy1 * srcW + sx1]));
+            }
+        }
+    }
+}
+
+void OcclusionCuller::rasterize(ThreadPool* pool)
+{
+    size_t tileCount = (size_t)tilesX * tilesY;
+    if (pool)
+    {
+        pool->parallelFor(tileCount, [this](size_t begin, size_t end)
+        {
+            for (size_t tile = begin; tile < end; ++tile)
+                rasterizeTile((int)(tile % tilesX), (int)(tile / tilesX));
+        });
+    }
+    else
+    {
+        for (size_t tile = 0; tile < tileCount; ++tile)
+            rasterizeTile((int)(tile % tilesX), (int)(tile / tilesX));
+    }
+    buildPyramid();
+}
+
+bool OcclusionCuller::isVisible(const float boundsMin[3], const float boundsMax[3]) const
+{
+    const float* m = viewProjection;
+    float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    float nearestDepth = INFINITY;
+
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        float p[3] = {
+            (corner & 1) ? boundsMax[0] : boundsMin[0],
+            (corner & 2) ? boundsMax[1] : boundsMin[1],
+            (corner & 4) ? boundsMax[2] : boundsMin[2]
+        };
+        float cw = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+        if (cw <= 1e-5f)
+            return true;
+        float invW = 1.0f / cw;
+        float sx = ((m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12]) * invW * 0.5f + 0.5f) * width;
+        float sy = ((m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13]) * invW * 0.5f + 0.5f) * height;
+        float sz = (m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14]) * invW * 0.5f + 0.5f;
+        minX = std::min(minX, sx); maxX = std::max(maxX, sx);
+        minY = std::min(minY, sy); maxY = std::max(maxY, sy);
+        nearestDepth = std::min(nearestDepth, sz);
+    }
+
+    if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+        return false;
+    minX = std::max(minX, 0.0f); minY = std::max(minY, 0.0f);
+    maxX = std::min(maxX, (float)(width - 1)); maxY = std::min(maxY, (float)(height - 1));
+
+    // Pick the level where the rectangle spans at most 8 texels per axis:
+    // coarser levels are cheaper but blur occluder edges into "visible".
+    float extent = std::max(maxX - minX, maxY - minY) / 8.0f;
+    size_t level = extent > 1.0f ? (size_t)std::ceil(std::log2(extent)) : 0;
+    level = std::min(level, pyramid.size() - 1);
+
+    int lx0 = (int)minX >> level, lx1 = (int)maxX >> level;
+    int ly0 = (int)minY >> level, ly1 = (int)maxY >> level;
+    const std::vector<float>& depth = pyramid[level];
+    int w = levelWidth[level], h = levelHeight[level];
+    // Levels round up, so every clamped pixel has a texel covering it and
+    // the test never has to fall back to a neighbour that misses the box.
+    assert(lx1 < w && ly1 < h);
+    for (int y = ly0; y <= ly1; ++y)
+        for (int x = lx0; x <= lx1; ++x)
+            if (nearestDepth <= depth[(size_t)y * w + x])
+                return true;
+    return false;
+}
+
+void OcclusionCuller::filter(const CullingSystem& culling, std::vector<unsigned int>& visible, ThreadPool* pool) const
+{
+    FrameVector<unsigned char> keep(visible.size(), 1);
+    auto testRange = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            float boundsMin[3], boundsMax[3];
+            culling.bounds(visible[i], boundsMin, boundsMax);
+            keep[i] = isVisible(boundsMin, boundsMax) ? 1 : 0;
+        }
+    };
+    if (pool)
+        pool->parallelFor(visible.size(), testRange, 1024);
+    else
+        testRange(0, visible.size());
+
+    size_t out = 0;
+    for (size_t i = 0; i < visible.size(); ++i)
+        if (keep[i])
+            visible[out++] = visible[i];
+    visible.resize(out);
+}
@@ -0,0 +1,56 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include "Culling.h"
+#include "ThreadPool.h"
+#include <cstddef>
+#include <vector>
+
+// CPU hierarchical-Z occlusion culling. Occluder triangles are rasterized
+// into a small depth buffer (nearest depth wins), a max-depth pyramid is
+// built on top, and instance bounds are tested against the pyramid level
+// where their screen rectangle covers a handful of texels.
+class OcclusionCuller
+{
+public:
+    // Width and height are rounded up to whole tiles.
+    OcclusionCuller(int width = 256, int height = 128);
+
+    // Clears the depth buffer and drops the occluders of the previous frame.
+    void beginFrame(const float* viewProjection);
+
+    // World-space positions, strideBytes apart. Triangles touching the near
+    // plane are skipped, which only ever makes the result more conservative.
+    void addOccluder(const float* positions, size_t strideBytes, const unsigned int* indices, size_t indexCount);
+
+    // Bins occluder triangles into tiles, rasterizes the tiles in parallel
+    // and builds the depth pyramid.
+    void rasterize(ThreadPool* pool = nullptr);
+
+    bool isVisible(const float boundsMin[3], const float boundsMax[3]) const;
+
+    // Removes occluded ids from visible, keeping the order of the rest.
+    void filter(const CullingSystem& culling, std::vector<unsigned int>& visible, ThreadPool* pool = nullptr) const;
+
+private:
+    struct ScreenTriangle
+    {
+        float x[3], y[3], z[3];
+        int minTileX, minTileY, maxTileX, maxTileY;
+    };
+
+    void rasterizeTile(int tileX, int tileY);
+    void buildPyramid();
+
+    static const int tileSize = 32;
+    int width, height;
+    int tilesX, tilesY;
+    float viewProjection[16];
+
+    std::vector<ScreenTriangle> triangles;
+    std::vector<std::vector<unsigned int>> tileBins;
+    std::vector<std::vector<float>> pyramid;   // level 0 is the depth buffer
+    std::vector<int> levelWidth, levelHeight;
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "PixelConvert.h"
+#include "Simd.h"
+#include <cstring>
+
+// Exact round(value * alpha / 255) for 8-bit inputs.
+static inline unsigned char multiplyByAlpha(unsigned int value, unsigned int alpha)
+{
+    unsigned int product = value * alpha + 128;
+    return (unsigned char)((product + (product >> 8)) >> 8);
+}
+
+void expandRgbToRgba(const unsigned char* source, unsigned char* destination, size_t count)
+{
+    size_t i = 0;
+#if SIMD_SSSE3
+    const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i opaque = _mm_set1_epi32((int)0xFF000000);
+    for (; i + 16 <= count; i += 16)
+    {
+        // 48 source bytes; each shuffle takes the 12 bytes of four pixels.
+        const unsigned char* in = source + i * 3;
+        __m128i first = _mm_loadu_si128((const __m128i*)in);
+        __m128i second = _mm_loadu_si128((const __m128i*)(in + 16));
+        __m128i third = _mm_loadu_si128((const __m128i*)(in + 32));
+        unsigned char* out = destination + i * 4;
+        _mm_storeu_si128((__m128i*)out, _mm_or_si128(_mm_shuffle_epi8(first, spread), opaque));
+        _mm_storeu_si128((__m128i*)(out + 16),
+            _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(second, first, 12), spread), opaque));
+        _mm_storeu_si128((__m128i*)(out + 32),
+            _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(third, second, 8), spread), opaque));
+        _mm_storeu_si128((__m128i*)(out + 48),
+            _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(third, 4), spread), opaque));
+    }
+#elif SIMD_SSE2
+    // Four pixels per step: the low 64-bit lane takes bytes 0-7 and the high
+    // lane bytes 6-13, then each lane keeps its first pixel in place and
+    // shifts the second up a byte into the next 32-bit word.
+    const __m128i firstPixel = _mm_set1_epi64x(0x0000000000FFFFFFll);
+    const __m128i secondPixel = _mm_set1_epi64x(0x00FFFFFF00000000ll);
+    const __m128i opaque = _mm_set1_epi32((int)0xFF000000);
+    // The 16-byte load runs four bytes past the 12 it uses.
+    for (; i + 6 <= count; i += 4)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(source + i * 3));
+        __m128i lanes = _mm_unpacklo_epi64(bytes, _mm_srli_si128(bytes, 6));
+        __m128i result = _mm_or_si128(_mm_and_si128(lanes, firstPixel),
+            _mm_and_si128(_mm_slli_epi64(lanes, 8), secondPixel));
+        _mm_storeu_si128((__m128i*)(destination + i * 4), _mm_or_si128(result, opaque));
+    }
+#else
+    // Scalar: move each pixel as one 32-bit word; the load reads a byte past
+    // the pixel, so the last one is left to the tail.
+    for (; i + 1 < count; ++i)
+    {
+        unsigned int pixel;
+        memcpy(&pixel, source + i * 3, 4);
+        pixel = (pixel & 0x00FFFFFFu) | 0xFF000000u;
+        memcpy(destination + i * 4, &pixel, 4);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        destination[i * 4 + 0] = source[i * 3 + 0];
+        destination[i * 4 + 1] = source[i * 3 + 1];
+        destination[i * 4 + 2] = source[i * 3 + 2];
+        destination[i * 4 + 3] = 255;
+    }
+}
+
+void premultiplyAlpha(unsigned char* pixels, size_t count, int channels)
+{
+    if (channels == 2)
+    {
+        for (size_t i = 0; i < count; ++i)
+            pixels[i * 2] = multiplyByAlpha(pixels[i * 2], pixels[i * 2 + 1]);
+        return;
+    }
+    if (channels != 4)
+        return;
+
+    size_t i = 0;
+#if SIMD_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi16(128);
+    const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i source = _mm_loadu_si128((const __m128i*)(pixels + i * 4));
+        __m128i low = _mm_unpacklo_epi8(source, zero);
+        __m128i high = _mm_unpackhi_epi8(source, zero);
+        // Broadcast each pixel's alpha across its four 16-bit lanes.
+        __m128i alphaLow = _mm_shufflehi_epi16(_mm_shufflelo_epi16(low, 0xFF), 0xFF);
+        __m128i alphaHigh = _mm_shufflehi_epi16(_mm_shufflelo_epi16(high, 0xFF), 0xFF);
+        // value * alpha fits in 16 bits unsigned; the divide by 255 is the
+        // same shift-and-add as multiplyByAlpha.
+        low = _mm_add_epi16(_mm_mullo_epi16(low, alphaLow), rounding);
+        high = _mm_add_epi16(_mm_mullo_epi16(high, alphaHigh), rounding);
+        low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+        __m128i result = _mm_packus_epi16(low, high);
+        result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, source));
+        _mm_storeu_si128((__m128i*)(pixels + i * 4), result);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        unsigned char* pixel = pixels + i * 4;
+        pixel[0] = multiplyByAlpha(pixel[0], pixel[3]);
+        pixel[1] = multiplyByAlpha(pixel[1], pixel[3]);
+        pixel[2] = multiplyByAlpha(pixel[2], pixel[3]);
+    }
+}
+
+void swizzleRgba(unsigned char* pixels, size_t count, const unsigned char order[4])
+{
+    size_t i = 0;
+#if SIMD_SSSE3
+    char lanes[16];
+    for (int p = 0; p < 4; ++p)
+    {
+        for (int c = 0; c < 4; ++c)
+            lanes[p * 4 + c] = (char)(p * 4 + (order[c] & 3));
+    }
+    const __m128i shuffle = _mm_loadu_si128((const __m128i*)lanes);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i source = _mm_loadu_si128((const __m128i*)(pixels + i * 4));
+        _mm_storeu_si128((__m128i*)(pixels + i * 4), _mm_shuffle_epi8(source, shuffle));
+    }
+#elif SIMD_SSE2
+    // Each output channel is its source byte shifted down to bit 0, masked
+    // and shifted up into place, with shift counts chosen at run time.
+    __m128i down[4], up[4];
+    for (int c = 0; c < 4; ++c)
+    {
+        down[c] = _mm_cvtsi32_si128((order[c] & 3) * 8);
+        up[c] = _mm_cvtsi32_si128(c * 8);
+    }
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i source = _mm_loadu_si128((const __m128i*)(pixels + i * 4));
+        __m128i result = _mm_setzero_si128();
+        for (int c = 0; c < 4; ++c)
+            result = _mm_or_si128(result, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(source, down[c]), byteMask), up[c]));
+        _mm_storeu_si128((__m128i*)(pixels + i * 4), result);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        unsigned char* pixel = pixels + i * 4;
+        unsigned char source[4] = { pixel[0], pixel[1], pixel[2], pixel[3] };
+        for (int c = 0; c < 4; ++c)
+            pixel[c] = source[order[c] & 3];
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef PIXEL_CONVERT_H
+#define PIXEL_CONVERT_H
+
+#include <cstddef>
+
+// Load-time 8-bit pixel conversions. SSSE3 covers the shuffles, with SSE2
+// shift-and-mask fallbacks for builds without it, and SSE2 the premultiply;
+// each falls back to scalar code for the tail and for non-x86 builds.
+
+// Appends an opaque alpha to every pixel; destination holds count * 4 bytes.
+void expandRgbToRgba(const unsigned char* source, unsigned char* destination, size_t count);
+
+// Multiplies colour by alpha, rounding to nearest, for 2-channel (grey,
+// alpha) or 4-channel pixels. Alpha itself is left as is.
+void premultiplyAlpha(unsigned char* pixels, size_t count, int channels);
+
+// Reorders RGBA pixels in place: channel i of the result is channel
+// order[i] of the source, so { 2, 1, 0, 3 } turns BGRA into RGBA.
+void swizzleRgba(unsigned char* pixels, size_t count, const unsigned char order[4]);
+
+#endif
@@ -0,0 +1,351 @@
+#include "PngDecoder.h"
+#include "DecodePool.h"
+#include "Inflate.h"
+#include "Simd.h"
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    enum PngFilter
+    {
+        FilterNone,
+        FilterSub,
+        FilterUp,
+        FilterAverage,
+        FilterPaeth
+    };
+
+    inline unsigned int readBigEndian(const unsigned char* p)
+    {
+        return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+    }
+
+    inline unsigned int chunkType(const char* name)
+    {
+        return readBigEndian((const unsigned char*)name);
+    }
+
+    inline unsigned char paeth(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = abs(p - a);
+        int pb = abs(p - b);
+        int pc = abs(p - c);
+        if (pa <= pb && pa <= pc)
+            return (unsigned char)a;
+        return (unsigned char)(pb <= pc ? b : c);
+    }
+
+#if SIMD_SSE2
+    // One pixel of 3 or 4 bytes in the low lanes of a register. The pixel
+    // size is a template argument so the copies compile to plain moves.
+    template <int Bpp>
+    inline __m128i loadPixel(const unsigned char* p)
+    {
+        int value = 0;
+        memcpy(&value, p, Bpp);
+        return _mm_cvtsi32_si128(value);
+    }
+
+    template <int Bpp>
+    inline void storePixel(unsigned char* p, __m128i pixel)
+    {
+        int value = _mm_cvtsi128_si32(pixel);
+        memcpy(p, &value, Bpp);
+    }
+
+    inline __m128i select(__m128i mask, __m128i ifTrue, __m128i ifFalse)
+    {
+        return _mm_or_si128(_mm_and_si128(mask, ifTrue), _mm_andnot_si128(mask, ifFalse));
+    }
+
+    inline __m128i absolute16(__m128i x)
+    {
+        return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+    }
+
+    // Sub, Average and Paeth depend on the reconstructed pixel to the left,
+    // so these step one pixel at a time with all its bytes in one register.
+    template <int Bpp>
+    void unfilterSubSimd(unsigned char* row, const unsigned char* filtered, size_t length)
+    {
+        __m128i left = _mm_setzero_si128();
+        for (size_t i = 0; i < length; i += Bpp)
+        {
+            left = _mm_add_epi8(left, loadPixel<Bpp>(filtered + i));
+            storePixel<Bpp>(row + i, left);
+        }
+    }
+
+    template <int Bpp>
+    void unfilterAverageSimd(unsigned char* row, const unsigned char* filtered, const unsigned char* prior,
+        size_t length)
+    {
+        const __m128i one = _mm_set1_epi8(1);
+        __m128i left = _mm_setzero_si128();
+        for (size_t i = 0; i < length; i += Bpp)
+        {
+            __m128i up = loadPixel<Bpp>(prior + i);
+            // avg_epu8 rounds up; PNG wants the floor.
+            __m128i average = _mm_sub_epi8(_mm_avg_epu8(left, up), _mm_and_si128(_mm_xor_si128(left, up), one));
+            left = _mm_add_epi8(average, loadPixel<Bpp>(filtered + i));
+            storePixel<Bpp>(row + i, left);
+        }
+    }
+
+    template <int Bpp>
+    void unfilterPaethSimd(unsigned char* row, const unsigned char* filtered, const unsigned char* prior,
+        size_t length)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i a = zero;
+        __m128i c = zero;
+        for (size_t i = 0; i < length; i += Bpp)
+        {
+            __m128i b = _mm_unpacklo_epi8(loadPixel<Bpp>(prior + i), zero);
+
+            // With p = a + b - c: |p - a| = |b - c|, |p - b| = |a - c| and
+            // |p - c| = |(b - c) + (a - c)|.
+            __m128i pa = _mm_sub_epi16(b, c);
+            __m128i pb = _mm_sub_epi16(a, c);
+            __m128i pc = absolute16(_mm_add_epi16(pa, pb));
+            pa = absolute16(pa);
+            pb = absolute16(pb);
+            __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            __m128i predictor = select(_mm_cmpeq_epi16(smallest, pa), a,
+                select(_mm_cmpeq_epi16(smallest, pb), b, c));
+
+            __m128i pixel = _mm_add_epi8(_mm_packus_epi16(predictor, predictor), loadPixel<Bpp>(filtered + i));
+            storePixel<Bpp>(row + i, pixel);
+            a = _mm_unpacklo_epi8(pixel, zero);
+            c = b;
+        }
+    }
+#endif
+
+    // Reconstructs one row; prior is the previous reconstructed row, all
+    // zeros for the first.
+    bool unfilterRow(unsigned char* row, const unsigned char* filtered, const unsigned char* prior, size_t length,
+        int bpp, unsigned char filter)
+    {
+        size_t i = 0;
+        switch (filter)
+        {
+        case FilterNone:
+            memcpy(row, filtered, length);
+            return true;
+
+        case FilterSub:
+#if SIMD_SSE2
+            if (bpp == 4)
+            {
+                unfilterSubSimd<4>(row, filtered, length);
+                return true;
+            }
+            if (bpp == 3)
+            {
+                unfilterSubSimd<3>(row, filtered, length);
+                return true;
+            }
+#endif
+            memcpy(row, filtered, bpp);
+            for (i = bpp; i < length; ++i)
+                row[i] = (unsigned char)(filtered[i] + row[i - bpp]);
+            return true;
+
+        case FilterUp:
+#if SIMD_SSE2
+            for (; i + 16 <= length; i += 16)
+            {
+                __m128i sum = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(filtered + i)),
+                    _mm_loadu_si128((const __m128i*)(prior + i)));
+                _mm_storeu_si128((__m128i*)(row + i), sum);
+            }
+#endif
+            for (; i < length; ++i)
+                row[i] = (unsigned char)(filtered[i] + prior[i]);
+            return true;
+
+        case FilterAverage:
+#if SIMD_SSE2
+            if (bpp == 4)
+            {
+                unfilterAverageSimd<4>(row, filtered, prior, length);
+                return true;
+            }
+            if (bpp == 3)
+            {
+                unfilterAverageSimd<3>(row, filtered, prior, length);
+                return true;
+            }
+#endif
+            for (; i < (size_t)bpp; ++i)
+                row[i] = (unsigned char)(filtered[i] + (prior[i] >> 1));
+            for (; i < length; ++i)
+                row[i] = (unsigned char)(filtered[i] + ((row[i - bpp] + prior[i]) >> 1));
+            return true;
+
+        case FilterPaeth:
+#if SIMD_SSE2
+            if (bpp == 4)
+            {
+                unfilterPaethSimd<4>(row, filtered, prior, length);
+                return true;
+            }
+            if (bpp == 3)
+            {
+                unfilterPaethSimd<3>(row, filtered, prior, length);
+                return true;
+            }
+#endif
+            for (; i < (size_t)bpp; ++i)
+                row[i] = (unsigned char)(filtered[i] + prior[i]);
+            for (; i < length; ++i)
+                row[i] = (unsigned char)(filtered[i] + paeth(row[i - bpp], prior[i], prior[i - bpp]));
+            return true;
+        }
+        return false;
+    }
+}
+
+unsigned char* decodePng(const unsigned char* bytes, size_t size, int* width, int* height, int* channels,
+    bool flipVertically)
+{
+    static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    if (size < 8 || memcmp(bytes, signature, 8) != 0)
+        return NULL;
+
+    unsigned int imageWidth = 0, imageHeight = 0;
+    int colorType = -1;
+    unsigned char palette[256 * 4] = {};
+    unsigned int paletteSize = 0;
+    bool paletteAlpha = false;
+    std::vector<std::pair<const unsigned char*, size_t>> idat;
+    size_t compressedSize = 0;
+    bool ended = false;
+
+    size_t position = 8;
+    while (!ended && size - position >= 12)
+    {
+        size_t length = readBigEndian(bytes + position);
+        unsigned int type = readBigEndian(bytes + position + 4);
+        const unsigned char* data = bytes + position + 8;
+        if (length > size - position - 12)
+            return NULL;
+
+        if (type == chunkType("IHDR"))
+        {
+            if (length != 13 || position != 8)
+                return NULL;
+            imageWidth = readBigEndian(data);
+            imageHeight = readBigEndian(data + 4);
+            colorType = data[9];
+            // 8-bit, standard compression and filtering, no interlacing.
+            if (data[8] != 8 || data[10] != 0 || data[11] != 0 || data[12] != 0)
+                return NULL;
+            if (colorType != 0 && colorType != 2 && colorType != 3 && colorType != 4 && colorType != 6)
+                return NULL;
+            if (imageWidth == 0 || imageHeight == 0 || imageWidth > (1u << 24) || imageHeight > (1u << 24))
+                return NULL;
+        }
+        else if (type == chunkType("PLTE"))
+        {
+            if (length % 3 != 0 || length > 768)
+                return NULL;
+            paletteSize = (unsigned int)(length / 3);
+            for (unsigned int i = 0; i < paletteSize; ++i)
+            {
+                palette[i * 4 + 0] = data[i * 3 + 0];
+                palette[i * 4 + 1] = data[i * 3 + 1];
+                palette[i * 4 + 2] = data[i * 3 + 2];
+                palette[i * 4 + 3] = 255;
+            }
+        }
+        else if (type == chunkType("tRNS"))
+        {
+            // stb_image adds an alpha channel for keyed greyscale and RGB;
+            // leave those to it.
+            if (colorType != 3 || paletteSize == 0 || length > paletteSize)
+                return NULL;
+            for (size_t i = 0; i < length; ++i)
+                palette[i * 4 + 3] = data[i];
+            paletteAlpha = true;
+        }
+        else if (type == chunkType("IDAT"))
+        {
+            idat.push_back(std::make_pair(data, length));
+            compressedSize += length;
+        }
+        else if (type == chunkType("IEND"))
+            ended = true;
+        else if (type == chunkType("CgBI") || !(bytes[position + 4] & 32))
+            return NULL;    // Apple's variant, or another critical chunk we do not know
+
+        position += 12 + length;
+    }
+    if (colorType < 0 || idat.empty() || (colorType == 3 && paletteSize == 0))
+        return NULL;
+
+    static const int sourceChannels[7] = { 1, 0, 3, 1, 2, 0, 4 };
+    int bpp = sourceChannels[colorType];
+    int outputChannels = colorType == 3 ? (paletteAlpha ? 4 : 3) : bpp;
+    size_t rowLength = (size_t)imageWidth * bpp;
+    size_t outputRow = (size_t)imageWidth * outputChannels;
+    if ((unsigned long long)outputRow * imageHeight > 0x7FFFFFFFull)
+        return NULL;
+
+    // Image data split over several IDAT chunks is one zlib stream.
+    std::vector<unsigned char> joined;
+    const unsigned char* compressed = idat[0].first;
+    if (idat.size() > 1)
+    {
+        joined.reserve(compressedSize);
+        for (const auto& chunk : idat)
+            joined.insert(joined.end(), chunk.first, chunk.first + chunk.second);
+        compressed = joined.data();
+    }
+
+    size_t rawSize = (rowLength + 1) * imageHeight;
+    unsigned char* raw = (unsigned char*)decodeAllocate(rawSize);
+    size_t written = 0;
+    if (!raw || !inflateZlib(compressed, compressedSize, raw, rawSize, written) || written != rawSize)
+    {
+        decodeFree(raw);
+        return NULL;
+    }
+
+    unsigned char* pixels = (unsigned char*)decodeAllocate(outputRow * imageHeight);
+    // Palette indices are unfiltered into two alternating scratch rows and
+    // expanded from there; other types unfilter straight into the output.
+    std::vector<unsigned char> scratch(rowLength * (colorType == 3 ? 3 : 1), 0);
+    const unsigned char* prior = scratch.data();
+    bool ok = pixels != NULL;
+    for (unsigned int y = 0; ok && y < imageHeight; ++y)
+    {
+        const unsigned char* filtered = raw + (size_t)y * (rowLength + 1);
+        unsigned char* target = pixels + (size_t)(flipVertically ? imageHeight - 1 - y : y) * outputRow;
+        unsigned char* row = colorType == 3 ? &scratch[rowLength * (1 + (y & 1))] : target;
+        ok = unfilterRow(row, filtered + 1, prior, rowLength, bpp, filtered[0]);
+        prior = row;
+
+        if (colorType == 3)
+        {
+            for (unsigned int x = 0; x < imageWidth; ++x)
+                memcpy(target + (size_t)x * outputChannels, palette + row[x] * 4, outputChannels);
+        }
+    }
+    decodeFree(raw);
+    if (!ok)
+    {
+        decodeFree(pixels);
+        return NULL;
+    }
+
+    *width = (int)imageWidth;
+    *height = (int)imageHeight;
+    *channels = outputChannels;
+    return pixels;
+}
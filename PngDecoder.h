@@ -0,0 +1,17 @@
+#ifndef PNG_DECODER_H
+#define PNG_DECODER_H
+
+#include <cstddef>
+
+// Fast path for the common PNG subset: 8-bit greyscale, grey+alpha, RGB,
+// RGBA and palette images without interlacing. Inflates with inflateZlib
+// and unfilters with SSE2 for 3- and 4-byte pixels. Output matches
+// stb_image with req_comp 0: palette images expand to RGB, or RGBA when
+// they carry tRNS. Returns NULL for anything else, including corrupt
+// files, so callers fall back to stb_image, which then reports the error.
+// The pixels come from the decode pool; free them with stbi_image_free.
+// Keeps no global state, so images may be decoded concurrently.
+unsigned char* decodePng(const unsigned char* bytes, size_t size, int* width, int* height, int* channels,
+    bool flipVertically);
+
+#endif
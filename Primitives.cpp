@@ -0,0 +1,297 @@
+#include "Primitives.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
+
+static constexpr auto unitGrid1 = makeGrid<1, 1>();
+static constexpr auto unitGrid2 = makeGrid<2, 2>();
+static constexpr auto unitGrid4 = makeGrid<4, 4>();
+static constexpr auto unitGrid8 = makeGrid<8, 8>();
+static constexpr auto unitPolygon3 = makePolygon<3>();
+static constexpr auto unitPolygon4 = makePolygon<4>();
+static constexpr auto unitPolygon5 = makePolygon<5>();
+static constexpr auto unitPolygon6 = makePolygon<6>();
+static constexpr auto unitPolygon8 = makePolygon<8>();
+
+PrimitiveDesc triangleDesc()
+{
+    PrimitiveDesc desc = {};
+    desc.shape = Triangle;
+    desc.tiling = 1.0f;
+    return desc;
+}
+
+PrimitiveDesc rectangleDesc(float tiling)
+{
+    PrimitiveDesc desc = {};
+    desc.shape = Rectangle;
+    desc.tiling = tiling;
+    return desc;
+}
+
+PrimitiveDesc gridDesc(unsigned int columns, unsigned int rows, float tiling)
+{
+    PrimitiveDesc desc = {};
+    desc.shape = Grid;
+    desc.segmentsX = std::max(columns, 1u);
+    desc.segmentsY = std::max(rows, 1u);
+    desc.tiling = tiling;
+    return desc;
+}
+
+PrimitiveDesc polygonDesc(unsigned int sides, float tiling)
+{
+    PrimitiveDesc desc = {};
+    desc.shape = Polygon;
+    desc.segmentsX = std::max(sides, 3u);
+    desc.tiling = tiling;
+    return desc;
+}
+
+PrimitiveDesc circleDesc(float maxChordError, float tiling)
+{
+    PrimitiveDesc desc = {};
+    desc.shape = Circle;
+    desc.maxError = maxChordError;
+    desc.tiling = tiling;
+    return desc;
+}
+
+PrimitiveDesc roundedRectangleDesc(float width, float height, float cornerRadius, unsigned int cornerSegments, float tiling)
+{
+    PrimitiveDesc desc = {};
+    desc.shape = RoundedRectangle;
+    desc.width = width;
+    desc.height = height;
+    desc.radius = std::min(cornerRadius, 0.5f * std::min(width, height));
+    desc.segmentsX = std::max(cornerSegments, 1u);
+    desc.tiling = tiling;
+    return desc;
+}
+
+template <size_t V, size_t I>
+static MeshData toMeshData(const FixedMesh<V, I>& fixed, float tiling)
+{
+    MeshData mesh;
+    mesh.vertices.assign(fixed.vertices, fixed.vertices + V);
+    mesh.indices.assign(fixed.indices, fixed.indices + I);
+    for (Vertex& v : mesh.vertices)
+    {
+        v.texCoord[0] *= tiling;
+        v.texCoord[1] *= tiling;
+    }
+    return mesh;
+}
+
+static MeshData generateGrid(unsigned int columns, unsigned int rows, float tiling)
+{
+    MeshData mesh;
+    mesh.vertices.resize((size_t)(columns + 1) * (rows + 1));
+    mesh.indices.resize((size_t)columns * rows * 6);
+
+    // Every vertex in a column shares x and u, every vertex in a row shares y
+    // and v, so a vertex is two per-column vectors plus two per-row offsets.
+    std::vector<Vertex> columnTemplate(columns + 1);
+    for (unsigned int x = 0; x <= columns; ++x)
+    {
+        float u = (float)x / columns;
+        columnTemplate[x] = { { u - 0.5f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { u * tiling, 0.0f } };
+    }
+
+    Vertex* dst = mesh.vertices.data();
+    for (unsigned int y = 0; y <= rows; ++y)
+    {
+        float t = (float)y / rows;
+#if defined(SIMD_SSE2)
+        __m128 rowA = _mm_setr_ps(0.0f, t - 0.5f, 0.0f, 0.0f);
+        __m128 rowB = _mm_setr_ps(0.0f, 0.0f, 0.0f, t * tiling);
+        for (unsigned int x = 0; x <= columns; ++x, ++dst)
+        {
+            const float* src = (const float*)&columnTemplate[x];
+            _mm_storeu_ps((float*)dst, _mm_add_ps(_mm_loadu_ps(src), rowA));
+            _mm_storeu_ps((float*)dst + 4, _mm_add_ps(_mm_loadu_ps(src + 4), rowB));
+        }
+#else
+        for (unsigned int x = 0; x <= columns; ++x, ++dst)
+        {
+            *dst = columnTemplate[x];
+            dst->position[1] = t - 0.5f;
+            dst->texCoord[1] = t * tiling;
+        }
+#endif
+    }
+
+    unsigned int stride = columns + 1;
+    unsigned int* index = mesh.indices.data();
+    for (unsigned int y = 0; y < rows; ++y)
+    {
+        unsigned int rowStart = y * stride;
+#if defined(SIMD_SSE2)
+        const __m128i pattern = _mm_setr_epi32(0, 1, (int)stride + 1, 0);
+        for (unsigned int x = 0; x < columns; ++x, index += 6)
+        {
+            unsigned int bl = rowStart + x;
+            _mm_storeu_si128((__m128i*)index, _mm_add_epi32(pattern, _mm_set1_epi32((int)bl)));
+            index[4] = bl + stride + 1;
+            index[5] = bl + stride;
+        }
+#else
+        for (unsigned int x = 0; x < columns; ++x, index += 6)
+        {
+            unsigned int bl = rowStart + x;
+            index[0] = bl; index[1] = bl + 1; index[2] = bl + stride + 1;
+            index[3] = bl; index[4] = bl + stride + 1; index[5] = bl + stride;
+        }
+#endif
+    }
+    return mesh;
+}
+
+static MeshData generateFan(const std::vector<float>& outline, float width, float height, float tiling)
+{
+    MeshData mesh;
+    size_t sides = outline.size() / 2;
+    mesh.vertices.resize(sides + 1);
+    mesh.indices.resize(sides * 3);
+
+    mesh.vertices[0] = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.5f * tiling, 0.5f * tiling } };
+    for (size_t s = 0; s < sides; ++s)
+    {
+        float x = outline[s * 2];
+        float y = outline[s * 2 + 1];
+        mesh.vertices[s + 1] = { { x, y, 0.0f }, { 1.0f, 1.0f, 1.0f },
+            { (x / width + 0.5f) * tiling, (y / height + 0.5f) * tiling } };
+        mesh.indices[s * 3 + 0] = 0;
+        mesh.indices[s * 3 + 1] = (unsigned int)s + 1;
+        mesh.indices[s * 3 + 2] = (unsigned int)((s + 1) % sides) + 1;
+    }
+    return mesh;
+}
+
+static MeshData generatePolygon(unsigned int sides, float tiling)
+{
+    std::vector<float> outline(sides * 2);
+    for (unsigned int s = 0; s < sides; ++s)
+    {
+        double angle = constexprPi / 2.0 + 2.0 * constexprPi * s / sides;
+        outline[s * 2] = (float)(0.5 * std::cos(angle));
+        outline[s * 2 + 1] = (float)(0.5 * std::sin(angle));
+    }
+    return generateFan(outline, 1.0f, 1.0f, tiling);
+}
+
+static unsigned int circleSides(float maxChordError)
+{
+    const float radius = 0.5f;
+    float error = std::min(std::max(maxChordError, 1e-5f), radius);
+    double sides = std::ceil(constexprPi / std::acos(1.0 - error / radius));
+    return (unsigned int)std::min(std::max(sides, 8.0), 4096.0);
+}
+
+static MeshData generateRoundedRectangle(const PrimitiveDesc& desc)
+{
+    float halfW = 0.5f * desc.width;
+    float halfH = 0.5f * desc.height;
+    float r = desc.radius;
+    const float centers[4][2] = {
+        { halfW - r,  halfH - r }, { -halfW + r,  halfH - r },
+        { -halfW + r, -halfH + r }, { halfW - r, -halfH + r }
+    };
+
+    std::vector<float> outline;
+    outline.reserve((desc.segmentsX + 1) * 8);
+    for (int corner = 0; corner < 4; ++corner)
+    {
+        for (unsigned int s = 0; s <= desc.segmentsX; ++s)
+        {
+            double angle = constexprPi / 2.0 * (corner + (double)s / desc.segmentsX);
+            outline.push_back(centers[corner][0] + r * (float)std::cos(angle));
+            outline.push_back(centers[corner][1] + r * (float)std::sin(angle));
+        }
+    }
+    return generateFan(outline, desc.width, desc.height, desc.tiling);
+}
+
+MeshData buildPrimitiveMesh(const PrimitiveDesc& desc)
+{
+    MeshData mesh;
+    float tiling = desc.tiling;
+
+    switch (desc.shape)
+    {
+    case Triangle:
+        mesh.vertices = {
+            {{  0.5f, -0.5f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f }},
+            {{ -0.5f, -0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f }},
+            {{  0.0f,  0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f }}
+        };
+        break;
+
+    case Rectangle:
+        mesh.vertices = {
+            {{  0.5f,  0.5f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f * tiling, 1.0f * tiling }},
+            {{  0.5f, -0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f * tiling, 0.0f }},
+            {{ -0.5f, -0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f }},
+            {{ -0.5f,  0.5f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { 0.0f, 1.0f * tiling }}
+        };
+        mesh.indices = {
+            0, 1, 3,
+            1, 2, 3
+        };
+        break;
+
+    case Grid:
+        if (desc.segmentsX == desc.segmentsY)
+        {
+            switch (desc.segmentsX)
+            {
+            case 1: return toMeshData(unitGrid1, tiling);
+            case 2: return toMeshData(unitGrid2, tiling);
+            case 4: return toMeshData(unitGrid4, tiling);
+            case 8: return toMeshData(unitGrid8, tiling);
+            }
+        }
+        return generateGrid(desc.segmentsX, desc.segmentsY, tiling);
+
+    case Polygon:
+        switch (desc.segmentsX)
+        {
+        case 3: return toMeshData(unitPolygon3, tiling);
+        case 4: return toMeshData(unitPolygon4, tiling);
+        case 5: return toMeshData(unitPolygon5, tiling);
+        case 6: return toMeshData(unitPolygon6, tiling);
+        case 8: return toMeshData(unitPolygon8, tiling);
+        }
+        return generatePolygon(desc.segmentsX, tiling);
+
+    case Circle:
+        return generatePolygon(circleSides(desc.maxError), tiling);
+
+    case RoundedRectangle:
+        return generateRoundedRectangle(desc);
+    }
+    return mesh;
+}
+
+PrimitiveBuffers setupPrimitive(PrimitiveShape shape, VertexFormat format) {
+    float tiling = 2.0f;
+    PrimitiveDesc desc = (shape == Triangle) ? triangleDesc() : rectangleDesc(tiling);
+    return uploadMesh(buildPrimitiveMesh(desc), format);
+}
+
+const PrimitiveBuffers& PrimitiveCache::get(const PrimitiveDesc& desc, VertexFormat format)
+{
+    Key key(desc.shape, desc.segmentsX, desc.segmentsY, desc.tiling, desc.width, desc.height, desc.radius, desc.maxError, format);
+    auto it = entries.find(key);
+    if (it != entries.end())
+        return it->second;
+
+    return entries.emplace(key, uploadMesh(buildPrimitiveMesh(desc), format)).first->second;
+}
+
+void PrimitiveCache::clear()
+{
+    for (auto& entry : entries)
+        destroyPrimitive(entry.second);
+    entries.clear();
+}
@@ -0,0 +1,135 @@
+#ifndef PRIMITIVES_H
+#define PRIMITIVES_H
+
+#include "Mesh.h"
+#include <cstddef>
+#include <map>
+#include <tuple>
+
+// Procedural primitives, all fitted to the [-0.5, 0.5] square the built-in
+// rectangle uses. Texture coordinates are scaled by the tiling factor.
+struct PrimitiveDesc
+{
+    PrimitiveShape shape;
+    unsigned int segmentsX;   // grid columns, polygon sides, corner segments
+    unsigned int segmentsY;   // grid rows
+    float tiling;
+    float width;
+    float height;
+    float radius;             // corner radius
+    float maxError;           // circle chord error
+};
+
+PrimitiveDesc triangleDesc();
+PrimitiveDesc rectangleDesc(float tiling);
+PrimitiveDesc gridDesc(unsigned int columns, unsigned int rows, float tiling);
+PrimitiveDesc polygonDesc(unsigned int sides, float tiling);
+PrimitiveDesc circleDesc(float maxChordError, float tiling);
+PrimitiveDesc roundedRectangleDesc(float width, float height, float cornerRadius, unsigned int cornerSegments, float tiling);
+
+MeshData buildPrimitiveMesh(const PrimitiveDesc& desc);
+PrimitiveBuffers setupPrimitive(PrimitiveShape shape, VertexFormat format = VertexHalf);
+
+// Uploads each distinct (desc, format) once and hands back the same buffers
+// on every later request. clear() must run while the GL context is alive.
+class PrimitiveCache
+{
+public:
+    const PrimitiveBuffers& get(const PrimitiveDesc& desc, VertexFormat format);
+    void clear();
+
+private:
+    typedef std::tuple<int, unsigned int, unsigned int, float, float, float, float, float, int> Key;
+    std::map<Key, PrimitiveBuffers> entries;
+};
+
+// Compile-time generation for small fixed-size primitives.
+template <size_t VertexCount, size_t IndexCount>
+struct FixedMesh
+{
+    Vertex vertices[VertexCount];
+    unsigned int indices[IndexCount];
+};
+
+constexpr double constexprPi = 3.14159265358979323846;
+
+constexpr double constexprSin(double x)
+{
+    while (x > constexprPi) x -= 2.0 * constexprPi;
+    while (x < -constexprPi) x += 2.0 * constexprPi;
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 12; ++n)
+    {
+        term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double constexprCos(double x)
+{
+    return constexprSin(x + constexprPi / 2.0);
+}
+
+template <unsigned int Columns, unsigned int Rows>
+constexpr FixedMesh<(Columns + 1) * (Rows + 1), Columns * Rows * 6> makeGrid()
+{
+    FixedMesh<(Columns + 1) * (Rows + 1), Columns * Rows * 6> mesh = {};
+    for (unsigned int y = 0; y <= Rows; ++y)
+    {
+        for (unsigned int x = 0; x <= Columns; ++x)
+        {
+            Vertex& v = mesh.vertices[y * (Columns + 1) + x];
+            float u = (float)x / Columns;
+            float t = (float)y / Rows;
+            v.position[0] = u - 0.5f;
+            v.position[1] = t - 0.5f;
+            v.color[0] = v.color[1] = v.color[2] = 1.0f;
+            v.texCoord[0] = u;
+            v.texCoord[1] = t;
+        }
+    }
+
+    unsigned int i = 0;
+    for (unsigned int y = 0; y < Rows; ++y)
+    {
+        for (unsigned int x = 0; x < Columns; ++x)
+        {
+            unsigned int bl = y * (Columns + 1) + x;
+            unsigned int br = bl + 1;
+            unsigned int tl = bl + Columns + 1;
+            unsigned int tr = tl + 1;
+            mesh.indices[i++] = bl; mesh.indices[i++] = br; mesh.indices[i++] = tr;
+            mesh.indices[i++] = bl; mesh.indices[i++] = tr; mesh.indices[i++] = tl;
+        }
+    }
+    return mesh;
+}
+
+template <unsigned int Sides>
+constexpr FixedMesh<Sides + 1, Sides * 3> makePolygon()
+{
+    static_assert(Sides >= 3, "a polygon needs at least three sides");
+    FixedMesh<Sides + 1, Sides * 3> mesh = {};
+    mesh.vertices[0].color[0] = mesh.vertices[0].color[1] = mesh.vertices[0].color[2] = 1.0f;
+    mesh.vertices[0].texCoord[0] = mesh.vertices[0].texCoord[1] = 0.5f;
+
+    for (unsigned int s = 0; s < Sides; ++s)
+    {
+        double angle = constexprPi / 2.0 + 2.0 * constexprPi * s / Sides;
+        Vertex& v = mesh.vertices[s + 1];
+        v.position[0] = (float)(0.5 * constexprCos(angle));
+        v.position[1] = (float)(0.5 * constexprSin(angle));
+        v.color[0] = v.color[1] = v.color[2] = 1.0f;
+        v.texCoord[0] = v.position[0] + 0.5f;
+        v.texCoord[1] = v.position[1] + 0.5f;
+
+        mesh.indices[s * 3 + 0] = 0;
+        mesh.indices[s * 3 + 1] = s + 1;
+        mesh.indices[s * 3 + 2] = (s + 1) % Sides + 1;
+    }
+    return mesh;
+}
+
+#endif
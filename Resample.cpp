@@ -0,0 +1,225 @@
+#include "Resample.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static float filterSupport(ResampleFilter filter)
+{
+    return filter == ResampleLanczos3 ? 3.0f : 2.0f;
+}
+
+static float filterWeight(ResampleFilter filter, float x)
+{
+    x = std::fabs(x);
+    if (filter == ResampleLanczos3)
+    {
+        if (x < 1e-6f)
+            return 1.0f;
+        if (x >= 3.0f)
+            return 0.0f;
+        const float pi = 3.14159265358979f;
+        float px = pi * x;
+        return 3.0f * std::sin(px) * std::sin(px / 3.0f) / (px * px);
+    }
+
+    // Mitchell-Netravali with B = C = 1/3.
+    if (x < 1.0f)
+        return (7.0f * x * x * x - 12.0f * x * x + 16.0f / 3.0f) / 6.0f;
+    if (x < 2.0f)
+        return (-7.0f / 3.0f * x * x * x + 12.0f * x * x - 20.0f * x + 32.0f / 3.0f) / 6.0f;
+    return 0.0f;
+}
+
+// For each output sample along one axis: the first source sample it reads
+// and maxTaps normalized weights, zero-padded past the ones it needs.
+struct Contributions
+{
+    std::vector<int> first;
+    std::vector<float> weights;
+    int maxTaps;
+};
+
+static Contributions computeContributions(int sourceSize, int destinationSize, ResampleFilter filter)
+{
+    Contributions result;
+    float scale = (float)destinationSize / sourceSize;
+    float stretch = std::max(1.0f, 1.0f / scale);
+    float support = filterSupport(filter) * stretch;
+    result.maxTaps = (int)std::ceil(support) * 2 + 1;
+    result.first.resize(destinationSize);
+    result.weights.assign((size_t)destinationSize * result.maxTaps, 0.0f);
+
+    for (int i = 0; i < destinationSize; ++i)
+    {
+        float center = (i + 0.5f) / scale;
+        int begin = std::max(0, (int)std::floor(center - support));
+        int end = std::min(sourceSize, (int)std::ceil(center + support));
+        end = std::min(end, begin + result.maxTaps);
+
+        float* weights = &result.weights[(size_t)i * result.maxTaps];
+        float total = 0.0f;
+        for (int s = begin; s < end; ++s)
+        {
+            weights[s - begin] = filterWeight(filter, (s + 0.5f - center) / stretch);
+            total += weights[s - begin];
+        }
+        if (total != 0.0f)
+        {
+            for (int k = 0; k < end - begin; ++k)
+                weights[k] /= total;
+        }
+        result.first[i] = begin;
+    }
+    return result;
+}
+
+static void resampleRow(const unsigned char* source, int sourceWidth, int channels, const Contributions& columns,
+    int destinationWidth, float* sourceRow, float* output)
+{
+    size_t count = (size_t)sourceWidth * channels;
+    size_t i = 0;
+#if SIMD_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(source + i));
+        __m128i low = _mm_unpacklo_epi8(bytes, zero);
+        __m128i high = _mm_unpackhi_epi8(bytes, zero);
+        _mm_storeu_ps(sourceRow + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)));
+        _mm_storeu_ps(sourceRow + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)));
+        _mm_storeu_ps(sourceRow + i + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)));
+        _mm_storeu_ps(sourceRow + i + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)));
+    }
+#endif
+    for (; i < count; ++i)
+        sourceRow[i] = source[i];
+
+    int taps = columns.maxTaps;
+    for (int x = 0; x < destinationWidth; ++x)
+    {
+        const float* weights = &columns.weights[(size_t)x * taps];
+        const float* texel = sourceRow + (size_t)columns.first[x] * channels;
+        int used = std::min(taps, sourceWidth - columns.first[x]);
+#if SIMD_SSE2
+        if (channels == 4)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (int k = 0; k < used; ++k)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(texel + k * 4)));
+            _mm_storeu_ps(output + (size_t)x * 4, sum);
+            continue;
+        }
+#endif
+        float sum[4] = {};
+        for (int k = 0; k < used; ++k)
+        {
+            for (int c = 0; c < channels; ++c)
+                sum[c] += weights[k] * texel[k * channels + c];
+        }
+        for (int c = 0; c < channels; ++c)
+            output[(size_t)x * channels + c] = sum[c];
+    }
+}
+
+// Rounds to nearest even, as _mm_cvtps_epi32 does in the vector loops,
+// so a texel's value does not depend on where it falls in the row.
+static inline unsigned char clampToByte(float value)
+{
+    value = value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value);
+    return (unsigned char)std::lrint(value);
+}
+
+static void resampleColumn(const float* rows, size_t rowLength, int first, const float* weights, int used,
+    unsigned char* destination)
+{
+    size_t i = 0;
+#if SIMD_AVX2
+    for (; i + 16 <= rowLength; i += 16)
+    {
+        __m256 sumLow = _mm256_setzero_ps();
+        __m256 sumHigh = _mm256_setzero_ps();
+        for (int k = 0; k < used; ++k)
+        {
+            const float* row = rows + (size_t)(first + k) * rowLength + i;
+            __m256 weight = _mm256_set1_ps(weights[k]);
+            sumLow = _mm256_add_ps(sumLow, _mm256_mul_ps(weight, _mm256_loadu_ps(row)));
+            sumHigh = _mm256_add_ps(sumHigh, _mm256_mul_ps(weight, _mm256_loadu_ps(row + 8)));
+        }
+        // packs work per 128-bit lane, so undo the interleave afterwards.
+        __m256i words = _mm256_packs_epi32(_mm256_cvtps_epi32(sumLow), _mm256_cvtps_epi32(sumHigh));
+        words = _mm256_permute4x64_epi64(words, 0xD8);
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128((__m128i*)(destination + i), bytes);
+    }
+#endif
+#if SIMD_SSE2
+    for (; i + 8 <= rowLength; i += 8)
+    {
+        __m128 sumLow = _mm_setzero_ps();
+        __m128 sumHigh = _mm_setzero_ps();
+        for (int k = 0; k < used; ++k)
+        {
+            const float* row = rows + (size_t)(first + k) * rowLength + i;
+            __m128 weight = _mm_set1_ps(weights[k]);
+            sumLow = _mm_add_ps(sumLow, _mm_mul_ps(weight, _mm_loadu_ps(row)));
+            sumHigh = _mm_add_ps(sumHigh, _mm_mul_ps(weight, _mm_loadu_ps(row + 4)));
+        }
+        __m128i words = _mm_packs_epi32(_mm_cvtps_epi32(sumLow), _mm_cvtps_epi32(sumHigh));
+        _mm_storel_epi64((__m128i*)(destination + i), _mm_packus_epi16(words, words));
+    }
+#endif
+    for (; i < rowLength; ++i)
+    {
+        float sum = 0.0f;
+        for (int k = 0; k < used; ++k)
+            sum += weights[k] * rows[(size_t)(first + k) * rowLength + i];
+        destination[i] = clampToByte(sum);
+    }
+}
+
+void resampleImage(const unsigned char* source, int sourceWidth, int sourceHeight, int channels,
+    unsigned char* destination, int destinationWidth, int destinationHeight,
+    ResampleFilter filter, ThreadPool* pool)
+{
+    Contributions columns = computeContributions(sourceWidth, destinationWidth, filter);
+    Contributions rows = computeContributions(sourceHeight, destinationHeight, filter);
+
+    size_t sourceStride = (size_t)sourceWidth * channels;
+    size_t rowLength = (size_t)destinationWidth * channels;
+
+    // Each band of output rows filters just the source rows it reads, so
+    // the intermediate stays small and bands are independent; neighbouring
+    // bands recompute a few shared rows.
+    auto resampleBand = [&](size_t begin, size_t end) {
+        int firstRow = rows.first[begin];
+        int lastRow = std::min(sourceHeight, rows.first[end - 1] + rows.maxTaps);
+        std::vector<float> sourceRow(sourceStride);
+        std::vector<float> horizontal((size_t)(lastRow - firstRow) * rowLength);
+        for (int y = firstRow; y < lastRow; ++y)
+        {
+            resampleRow(source + (size_t)y * sourceStride, sourceWidth, channels, columns, destinationWidth,
+                sourceRow.data(), &horizontal[(size_t)(y - firstRow) * rowLength]);
+        }
+        for (size_t y = begin; y < end; ++y)
+        {
+            int first = rows.first[y];
+            int used = std::min(rows.maxTaps, sourceHeight - first);
+            resampleColumn(horizontal.data(), rowLength, first - firstRow, &rows.weights[y * rows.maxTaps], used,
+                destination + y * rowLength);
+        }
+    };
+
+    const size_t bandRows = 32;
+    size_t bands = ((size_t)destinationHeight + bandRows - 1) / bandRows;
+    auto runBands = [&](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; ++band)
+            resampleBand(band * bandRows, std::min((size_t)destinationHeight, (band + 1) * bandRows));
+    };
+
+    // Small images are not worth the hand-off.
+    if (pool && (size_t)sourceWidth * sourceHeight >= 256 * 256)
+        pool->parallelFor(bands, runBands, 1);
+    else
+        runBands(0, bands);
+}
@@ -0,0 +1,19 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include "ThreadPool.h"
+
+enum ResampleFilter
+{
+    ResampleMitchell,
+    ResampleLanczos3
+};
+
+// Separable resize of an 8-bit image with interleaved channels (1 to 4)
+// and tightly packed rows. Output rows are processed in bands, spread over
+// pool when one is given and the image is large.
+void resampleImage(const unsigned char* source, int sourceWidth, int sourceHeight, int channels,
+    unsigned char* destination, int destinationWidth, int destinationHeight,
+    ResampleFilter filter = ResampleMitchell, ThreadPool* pool = nullptr);
+
+#endif
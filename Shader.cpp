@@ -5,71 +5,83 @@
 
 Shader::Shader(const char* vertexPath, const char* fragmentPath)
 {
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
+    build(vertexPath, fragmentPath, NULL, std::vector<const char*>());
+}
 
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath,
+    const std::vector<const char*>& feedbackVaryings)
+{
+    build(vertexPath, fragmentPath, geometryPath, feedbackVaryings);
+}
+
+std::string Shader::readFile(const char* path)
+{
+    std::ifstream file;
+    file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     try
     {
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        vShaderFile.close();
-        fShaderFile.close();
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        file.open(path);
+        std::stringstream stream;
+        stream << file.rdbuf();
+        file.close();
+        return stream.str();
     }
     catch (std::ifstream::failure& e)
     {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
     }
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
+    return std::string();
+}
 
-    unsigned int vertex, fragment;
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+unsigned int Shader::compile(GLenum stage, const std::string& code, std::string type)
+{
+    const char* source = code.c_str();
+    unsigned int shader = glCreateShader(stage);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    checkCompileErrors(shader, type);
+    return shader;
+}
 
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+void Shader::build(const char* vertexPath, const char* fragmentPath, const char* geometryPath,
+    const std::vector<const char*>& feedbackVaryings)
+{
+    unsigned int vertex = compile(GL_VERTEX_SHADER, readFile(vertexPath), "VERTEX");
+    unsigned int fragment = fragmentPath ? compile(GL_FRAGMENT_SHADER, readFile(fragmentPath), "FRAGMENT") : 0;
+    unsigned int geometry = geometryPath ? compile(GL_GEOMETRY_SHADER, readFile(geometryPath), "GEOMETRY") : 0;
 
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+    program = ProgramObject::create();
+    glAttachShader(program.id(), vertex);
+    if (fragment) glAttachShader(program.id(), fragment);
+    if (geometry) glAttachShader(program.id(), geometry);
+    if (!feedbackVaryings.empty())
+        glTransformFeedbackVaryings(program.id(), (GLsizei)feedbackVaryings.size(), feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(program.id());
+    checkCompileErrors(program.id(), "PROGRAM");
 
     glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    if (fragment) glDeleteShader(fragment);
+    if (geometry) glDeleteShader(geometry);
 }
 
 void Shader::use() const
 {
-    glUseProgram(ID);
+    glUseProgram(program.id());
 }
 
 void Shader::setBool(const std::string& name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniform1i(glGetUniformLocation(program.id(), name.c_str()), (int)value);
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(glGetUniformLocation(program.id(), name.c_str()), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(glGetUniformLocation(program.id(), name.c_str()), value);
 }
 
 void Shader::checkCompileErrors(unsigned int shader, std::string type)
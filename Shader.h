@@ -2,21 +2,34 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include "GpuResources.h"
 #include <string>
+#include <vector>
 
 class Shader
 {
 public:
-    unsigned int ID;
-
     Shader(const char* vertexPath, const char* fragmentPath);
+    // fragmentPath and geometryPath may be NULL. Varyings listed in
+    // feedbackVaryings are captured interleaved by transform feedback.
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath,
+        const std::vector<const char*>& feedbackVaryings);
     void use() const;
+    // The program name; read it through here so a moved-from Shader reports
+    // 0 rather than a name it no longer owns.
+    unsigned int id() const { return program.id(); }
 
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
     void setFloat(const std::string& name, float value) const;
 
 private:
+    ProgramObject program;
+
+    void build(const char* vertexPath, const char* fragmentPath, const char* geometryPath,
+        const std::vector<const char*>& feedbackVaryings);
+    std::string readFile(const char* path);
+    unsigned int compile(GLenum stage, const std::string& code, std::string type);
     void checkCompileErrors(unsigned int shader, std::string type);
 };
 
@@ -0,0 +1,37 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// Instruction set selection shared by the SIMD code paths. Everything is
+// decided at compile time from the compiler's target flags (/arch:AVX2 on
+// MSVC, -mavx2 -mf16c on GCC/Clang); each path keeps a scalar fallback.
+// MSVC never defines __SSSE3__ or __F16C__, which is why they are implied
+// by __AVX__ and __AVX2__ below. The Visual Studio configurations keep the
+// SSE2 baseline; only the opt-in ReleaseAVX2|x64 one builds with /arch:AVX2
+// and so needs a Haswell-class CPU.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#define SIMD_SSSE3 1
+#include <tmmintrin.h>
+#endif
+
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define SIMD_SSE41 1
+#include <smmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__F16C__) || defined(__AVX2__)
+#define SIMD_F16C 1
+#include <immintrin.h>
+#endif
+
+#endif
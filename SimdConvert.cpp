@@ -0,0 +1,240 @@
+#include "SimdConvert.h"
+#include "Simd.h"
+#include <cmath>
+#include <cstring>
+
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t absBits = bits & 0x7fffffffu;
+
+    if (absBits > 0x7f800000u)
+        return (uint16_t)(sign | 0x7e00u);
+    if (absBits >= 0x477ff000u)
+        return (uint16_t)(sign | 0x7c00u);
+    if (absBits < 0x38800000u)
+    {
+        // Subnormal half: let the FPU round by adding 0.5f, whose mantissa
+        // lines up with the half subnormal step.
+        float absValue;
+        std::memcpy(&absValue, &absBits, sizeof(absValue));
+        absValue += 0.5f;
+        uint32_t rounded;
+        std::memcpy(&rounded, &absValue, sizeof(rounded));
+        return (uint16_t)(sign | (rounded - 0x3f000000u));
+    }
+
+    uint32_t mantissaOdd = (absBits >> 13) & 1u;
+    absBits += 0xc8000fffu + mantissaOdd;
+    return (uint16_t)(sign | (absBits >> 13));
+}
+
+float halfToFloat(uint16_t value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+    uint32_t bits;
+
+    if (exponent == 0)
+    {
+        float magnitude = (float)mantissa * (1.0f / 16777216.0f);
+        std::memcpy(&bits, &magnitude, sizeof(bits));
+        bits |= sign;
+    }
+    else if (exponent == 31)
+    {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+#if defined(SIMD_SSE2) && !defined(SIMD_F16C)
+static inline __m128i select4(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Same rounding as floatToHalf, four lanes at a time. The result sits in the
+// low 16 bits of each 32-bit lane.
+static inline __m128i floatToHalf4(__m128 value)
+{
+    const __m128i signMask = _mm_set1_epi32((int)0x80000000u);
+    __m128i bits = _mm_castps_si128(value);
+    __m128i sign = _mm_srli_epi32(_mm_and_si128(bits, signMask), 16);
+    __m128i absBits = _mm_andnot_si128(signMask, bits);
+
+    __m128i isNan = _mm_cmpgt_epi32(absBits, _mm_set1_epi32(0x7f800000));
+    __m128i isOverflow = _mm_cmpgt_epi32(absBits, _mm_set1_epi32(0x477fefff));
+    __m128i isSubnormal = _mm_cmplt_epi32(absBits, _mm_set1_epi32(0x38800000));
+
+    __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(absBits, 13), _mm_set1_epi32(1));
+    __m128i normal = _mm_add_epi32(absBits, _mm_set1_epi32((int)0xc8000fffu));
+    normal = _mm_srli_epi32(_mm_add_epi32(normal, mantissaOdd), 13);
+
+    __m128 subnormalFloat = _mm_add_ps(_mm_castsi128_ps(absBits), _mm_set1_ps(0.5f));
+    __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(subnormalFloat), _mm_set1_epi32(0x3f000000));
+
+    __m128i result = select4(isSubnormal, subnormal, normal);
+    result = select4(isOverflow, _mm_set1_epi32(0x7c00), result);
+    result = select4(isNan, _mm_set1_epi32(0x7e00), result);
+    return _mm_or_si128(result, sign);
+}
+
+static inline __m128i packLow16(__m128i a, __m128i b)
+{
+    a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+    b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+    return _mm_packs_epi32(a, b);
+}
+#endif
+
+void convertFloatToHalf(const float* src, uint16_t* dst, size_t count)
+{
+    size_t i = 0;
+#if defined(SIMD_F16C)
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i*)(dst + i), halves);
+    }
+#elif defined(SIMD_SSE2)
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i lo = floatToHalf4(_mm_loadu_ps(src + i));
+        __m128i hi = floatToHalf4(_mm_loadu_ps(src + i + 4));
+        _mm_storeu_si128((__m128i*)(dst + i), packLow16(lo, hi));
+    }
+#endif
+    for (; i < count; ++i)
+        dst[i] = floatToHalf(src[i]);
+}
+
+void convertFloatToSnorm16(const float* src, int16_t* dst, size_t count)
+{
+    size_t i = 0;
+#if defined(SIMD_SSE2)
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minusOne = _mm_set1_ps(-1.0f);
+    const __m128 scale = _mm_set1_ps(32767.0f);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), minusOne), one);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), minusOne), one);
+        __m128i ia = _mm_cvtps_epi32(_mm_mul_ps(a, scale));
+        __m128i ib = _mm_cvtps_epi32(_mm_mul_ps(b, scale));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(ia, ib));
+    }
+#endif
+    // lrint rounds to nearest even like _mm_cvtps_epi32, so a value comes
+    // out the same whether it lands in the vector loop or the tail.
+    for (; i < count; ++i)
+    {
+        float v = src[i] < -1.0f ? -1.0f : (src[i] > 1.0f ? 1.0f : src[i]);
+        dst[i] = (int16_t)std::lrint(v * 32767.0f);
+    }
+}
+
+void convertFloatToUnorm8(const float* src, uint8_t* dst, size_t count)
+{
+    size_t i = 0;
+#if defined(SIMD_SSE2)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i q[4];
+        for (int k = 0; k < 4; ++k)
+        {
+            __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4 * k), zero), one);
+            q[k] = _mm_cvtps_epi32(_mm_mul_ps(v, scale));
+        }
+        __m128i lo = _mm_packs_epi32(q[0], q[1]);
+        __m128i hi = _mm_packs_epi32(q[2], q[3]);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        float v = src[i] < 0.0f ? 0.0f : (src[i] > 1.0f ? 1.0f : src[i]);
+        dst[i] = (uint8_t)std::lrint(v * 255.0f);
+    }
+}
+
+// Unsigned float with a 5-bit exponent (bias 15) and mantissaBits of
+// mantissa, as used by GL_R11F_G11F_B10F. Rounds to nearest even.
+static inline uint32_t floatToSmallFloat(float value, int mantissaBits)
+{
+    float largest = std::ldexp(2.0f - std::ldexp(1.0f, -mantissaBits), 15);
+    value = value > 0.0f ? value : 0.0f;    // also maps NaN to 0
+    value = value < largest ? value : largest;
+    if (value < 1.0f / 16384.0f)
+        return (uint32_t)std::lrint(value * (float)(1 << (14 + mantissaBits)));
+
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    int dropped = 23 - mantissaBits;
+    bits -= 112u << 23;
+    return (bits + (1u << (dropped - 1)) - 1 + ((bits >> dropped) & 1u)) >> dropped;
+}
+
+#if defined(SIMD_SSE2)
+// floatToSmallFloat for four lanes.
+template <int MantissaBits>
+static inline __m128i floatToSmallFloat4(__m128 value)
+{
+    const int dropped = 23 - MantissaBits;
+    const __m128 largest = _mm_set1_ps((2.0f - 1.0f / (1 << MantissaBits)) * 32768.0f);
+    // max_ps returns its second operand for NaN.
+    value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), largest);
+
+    __m128i denormal = _mm_cvtps_epi32(_mm_mul_ps(value, _mm_set1_ps((float)(1 << (14 + MantissaBits)))));
+    __m128i bits = _mm_sub_epi32(_mm_castps_si128(value), _mm_set1_epi32(112 << 23));
+    __m128i odd = _mm_and_si128(_mm_srli_epi32(bits, dropped), _mm_set1_epi32(1));
+    bits = _mm_add_epi32(bits, _mm_add_epi32(_mm_set1_epi32((1 << (dropped - 1)) - 1), odd));
+    __m128i normal = _mm_srli_epi32(bits, dropped);
+
+    __m128i isDenormal = _mm_castps_si128(_mm_cmplt_ps(value, _mm_set1_ps(1.0f / 16384.0f)));
+    return _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+}
+#endif
+
+void convertFloatToR11G11B10(const float* rgb, uint32_t* dst, size_t count)
+{
+    size_t i = 0;
+#if defined(SIMD_SSE2)
+    for (; i + 4 <= count; i += 4)
+    {
+        // Transpose four RGB triples into R, G and B vectors.
+        __m128 a = _mm_loadu_ps(rgb + i * 3);        // r0 g0 b0 r1
+        __m128 b = _mm_loadu_ps(rgb + i * 3 + 4);    // g1 b1 r2 g2
+        __m128 c = _mm_loadu_ps(rgb + i * 3 + 8);    // b2 r3 g3 b3
+        __m128 red = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 1, 0, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+        __m128 green = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 0, 1)),
+            _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 2, 0, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 blue = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 1, 0, 2)),
+            _mm_shuffle_ps(c, c, _MM_SHUFFLE(0, 0, 3, 0)), _MM_SHUFFLE(1, 0, 2, 0));
+
+        __m128i packed = _mm_or_si128(floatToSmallFloat4<6>(red),
+            _mm_or_si128(_mm_slli_epi32(floatToSmallFloat4<6>(green), 11), _mm_slli_epi32(floatToSmallFloat4<5>(blue), 22)));
+        _mm_storeu_si128((__m128i*)(dst + i), packed);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        const float* texel = rgb + i * 3;
+        dst[i] = floatToSmallFloat(texel[0], 6) | (floatToSmallFloat(texel[1], 6) << 11) |
+            (floatToSmallFloat(texel[2], 5) << 22);
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef SIMD_CONVERT_H
+#define SIMD_CONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Bulk float -> packed conversions. Uses F16C/SSE2 when the compiler
+// targets them and falls back to scalar code for the tail and other CPUs.
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+
+void convertFloatToHalf(const float* src, uint16_t* dst, size_t count);
+// Clamp to [-1, 1] / [0, 1], scale and round to nearest even.
+void convertFloatToSnorm16(const float* src, int16_t* dst, size_t count);
+void convertFloatToUnorm8(const float* src, uint8_t* dst, size_t count);
+
+// Packs RGB float triples into GL_UNSIGNED_INT_10F_11F_11F_REV texels,
+// rounding to nearest even. Negative values and NaN become 0; values past
+// the largest finite 11/10-bit float clamp to it rather than to infinity.
+void convertFloatToR11G11B10(const float* rgb, uint32_t* dst, size_t count);
+
+#endif
@@ -0,0 +1,525 @@
+#include "Texture.h"
+#include "DecodePool.h"
+#include "GpuMemory.h"
+#include "MappedFile.h"
+#include "PixelConvert.h"
+#include "PngDecoder.h"
+#include "SimdConvert.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+static int skippedLevels(int width, int height, GLenum format, const TextureLoadOptions& options)
+{
+    int levels = (int)options.quality;
+    while ((width >> levels) > 1 || (height >> levels) > 1)
+    {
+        if (options.maxBytes == 0 ||
+            textureMemorySize(std::max(1, width >> levels), std::max(1, height >> levels), format, true) <= options.maxBytes)
+            break;
+        ++levels;
+    }
+    return levels;
+}
+
+// Conversion stage between decode and upload, on pixels from
+// decodeEncodedImage, which are already one or two channels or RGBA.
+static void convertDecodedPixels(unsigned char* data, int nrChannels, int width, int height,
+    const TextureLoadOptions& options)
+{
+    size_t count = (size_t)width * height;
+    if (options.premultiplyAlpha)
+        premultiplyAlpha(data, count, nrChannels);
+    const unsigned char* order = options.swizzle;
+    if (nrChannels == 4 && (order[0] != 0 || order[1] != 1 || order[2] != 2 || order[3] != 3))
+        swizzleRgba(data, count, order);
+}
+
+// Everything but greyscale gets the identity mask back, since TextureCache
+// reuploads into old textures.
+void setTextureSwizzle(GLenum target, int nrChannels)
+{
+    GLint identity[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+    GLint grey[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+    GLint greyAlpha[4] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+    const GLint* mask = nrChannels == 1 ? grey : (nrChannels == 2 ? greyAlpha : identity);
+    glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, mask);
+}
+
+// Mip chain, sampling state and memory accounting once level 0 of the
+// bound texture is in place.
+static void finishTextureUpload(unsigned int textureID, int nrChannels, int width, int height, GLenum internalFormat)
+{
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    setTextureSwizzle(GL_TEXTURE_2D, nrChannels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    GpuMemory::shared().record(GpuTexture, textureID, GpuMemoryTextures, textureMemorySize(width, height, internalFormat, true));
+}
+
+// Level 0 of a texture, decoded, converted and reduced, ready for
+// glTexImage2D. Built without touching GL, so it can be made on a worker.
+struct PreparedTexture
+{
+    PreparedTexture() = default;
+    PreparedTexture(const PreparedTexture&) = delete;
+    PreparedTexture& operator=(const PreparedTexture&) = delete;
+    ~PreparedTexture() { stbi_image_free(decoded); }
+
+    const void* pixels() const { return decoded ? (const void*)decoded : (const void*)storage.data(); }
+
+    unsigned char* decoded = NULL;          // decoder output, when uploaded as is
+    std::vector<unsigned char> storage;     // otherwise
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    TextureFormat format;
+};
+
+static void uploadPreparedTexture(unsigned int textureID, const PreparedTexture& image)
+{
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, image.format.internalFormat, image.width, image.height, 0, image.format.format,
+        image.format.type, image.pixels());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    finishTextureUpload(textureID, image.channels, image.width, image.height, image.format.internalFormat);
+}
+
+// Takes ownership of data, as returned by decodeEncodedImage.
+static void prepareDecodedTexture(unsigned char* data, int nrChannels, const TextureLoadOptions& options,
+    PreparedTexture& image)
+{
+    convertDecodedPixels(data, nrChannels, image.width, image.height, options);
+    static const GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    image.format.format = formats[nrChannels - 1];
+    image.format.internalFormat = image.format.format;
+    image.format.type = GL_UNSIGNED_BYTE;
+    image.channels = nrChannels;
+
+    int levels = skippedLevels(image.width, image.height, image.format.internalFormat, options);
+    if (levels == 0)
+    {
+        image.decoded = data;
+        return;
+    }
+    int targetWidth = std::max(1, image.width >> levels);
+    int targetHeight = std::max(1, image.height >> levels);
+    image.storage.resize((size_t)targetWidth * targetHeight * nrChannels);
+    resampleImage(data, image.width, image.height, nrChannels, image.storage.data(), targetWidth, targetHeight,
+        options.filter, &ThreadPool::shared());
+    stbi_image_free(data);
+    image.width = targetWidth;
+    image.height = targetHeight;
+}
+
+// 2x2 box filter for float and 16-bit images, which the 8-bit resampler
+// does not take. Odd edges repeat their last row or column.
+template <typename T>
+static std::vector<T> halveImage(const T* source, int& width, int& height, int channels)
+{
+    int halfWidth = std::max(1, width / 2);
+    int halfHeight = std::max(1, height / 2);
+    std::vector<T> result((size_t)halfWidth * halfHeight * channels);
+    for (int y = 0; y < halfHeight; ++y)
+    {
+        const T* row0 = source + (size_t)std::min(2 * y, height - 1) * width * channels;
+        const T* row1 = source + (size_t)std::min(2 * y + 1, height - 1) * width * channels;
+        T* out = &result[(size_t)y * halfWidth * channels];
+        for (int x = 0; x < halfWidth; ++x)
+        {
+            int x0 = std::min(2 * x, width - 1) * channels;
+            int x1 = std::min(2 * x + 1, width - 1) * channels;
+            for (int c = 0; c < channels; ++c)
+            {
+                float sum = (float)row0[x0 + c] + (float)row0[x1 + c] + (float)row1[x0 + c] + (float)row1[x1 + c];
+                out[x * channels + c] = std::is_integral<T>::value ? (T)(sum * 0.25f + 0.5f) : (T)(sum * 0.25f);
+            }
+        }
+    }
+    width = halfWidth;
+    height = halfHeight;
+    return result;
+}
+
+// Radiance files decode to float and are packed to half floats, or to
+// R11G11B10 when asked, on the thread pool a band of rows per task.
+static bool prepareHdrTexture(const unsigned char* bytes, size_t size, const TextureLoadOptions& options,
+    PreparedTexture& image)
+{
+    bool packed = options.hdrFormat == TextureHdrR11G11B10;
+    int channels = packed ? 3 : 4;
+    int width, height, fileChannels;
+    stbi_set_flip_vertically_on_load_thread(true);
+    float* data = stbi_loadf_from_memory(bytes, (int)size, &width, &height, &fileChannels, channels);
+    if (!data)
+        return false;
+
+    image.format.internalFormat = packed ? GL_R11F_G11F_B10F : GL_RGBA16F;
+    image.format.format = packed ? GL_RGB : GL_RGBA;
+    image.format.type = packed ? GL_UNSIGNED_INT_10F_11F_11F_REV : GL_HALF_FLOAT;
+    image.channels = channels;
+
+    std::vector<float> reduced;
+    const float* pixels = data;
+    for (int levels = skippedLevels(width, height, image.format.internalFormat, options); levels > 0; --levels)
+    {
+        reduced = halveImage(pixels, width, height, channels);
+        pixels = reduced.data();
+    }
+
+    size_t texels = (size_t)width * height;
+    image.storage.resize(packed ? texels * sizeof(uint32_t) : texels * 4 * sizeof(uint16_t));
+    uint32_t* packedTexels = (uint32_t*)image.storage.data();
+    uint16_t* halves = (uint16_t*)image.storage.data();
+    size_t rowTexels = (size_t)width;
+    ThreadPool::shared().parallelFor((size_t)height, [&](size_t begin, size_t end) {
+        size_t first = begin * rowTexels;
+        size_t count = (end - begin) * rowTexels;
+        if (packed)
+            convertFloatToR11G11B10(pixels + first * 3, packedTexels + first, count);
+        else
+            convertFloatToHalf(pixels + first * 4, halves + first * 4, count * 4);
+    }, 16);
+    stbi_image_free(data);
+    image.width = width;
+    image.height = height;
+    return true;
+}
+
+// 16-bit PNGs stay 16-bit unorm: as small as half floats, but exact.
+static bool prepare16BitTexture(const unsigned char* bytes, size_t size, const TextureLoadOptions& options,
+    PreparedTexture& image)
+{
+    int width, height, fileChannels;
+    if (!stbi_info_from_memory(bytes, (int)size, &width, &height, &fileChannels))
+        return false;
+    int channels = fileChannels == 3 ? 4 : fileChannels;
+    stbi_set_flip_vertically_on_load_thread(true);
+    unsigned short* data = stbi_load_16_from_memory(bytes, (int)size, &width, &height, &fileChannels, channels);
+    if (!data)
+        return false;
+
+    static const GLenum internalFormats[4] = { GL_R16, GL_RG16, GL_RGB16, GL_RGBA16 };
+    static const GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    image.format.internalFormat = internalFormats[channels - 1];
+    image.format.format = formats[channels - 1];
+    image.format.type = GL_UNSIGNED_SHORT;
+    image.channels = channels;
+
+    int levels = skippedLevels(width, height, image.format.internalFormat, options);
+    if (levels == 0)
+    {
+        image.decoded = (unsigned char*)data;
+        image.width = width;
+        image.height = height;
+        return true;
+    }
+    std::vector<unsigned short> reduced;
+    const unsigned short* pixels = data;
+    for (; levels > 0; --levels)
+    {
+        reduced = halveImage(pixels, width, height, channels);
+        pixels = reduced.data();
+    }
+    image.storage.resize(reduced.size() * sizeof(unsigned short));
+    memcpy(image.storage.data(), reduced.data(), image.storage.size());
+    stbi_image_free(data);
+    image.width = width;
+    image.height = height;
+    return true;
+}
+
+// Widens 1-, 2- or 3-channel pixels to RGBA; data is replaced on success
+// and stays owned by the caller either way.
+static bool expandToRgba(unsigned char*& data, int& nrChannels, size_t count)
+{
+    unsigned char* expanded = (unsigned char*)decodeAllocate(count * 4);
+    if (!expanded)
+        return false;
+    if (nrChannels == 3)
+    {
+        expandRgbToRgba(data, expanded, count);
+    }
+    else
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            unsigned char grey = data[i * nrChannels];
+            expanded[i * 4 + 0] = grey;
+            expanded[i * 4 + 1] = grey;
+            expanded[i * 4 + 2] = grey;
+            expanded[i * 4 + 3] = nrChannels == 2 ? data[i * 2 + 1] : 255;
+        }
+    }
+    stbi_image_free(data);
+    data = expanded;
+    nrChannels = 4;
+    return true;
+}
+
+// PNGs in the subset decodePng handles skip stb_image; everything else,
+// and anything it rejects, goes through stb. Free with stbi_image_free.
+static unsigned char* decodeEncodedImage(const unsigned char* bytes, size_t size, int& width, int& height,
+    int& nrChannels, int desiredChannels)
+{
+    unsigned char* data = decodePng(bytes, size, &width, &height, &nrChannels, true);
+    if (!data)
+    {
+        // RGB is expanded to RGBA anyway, so let stb do it: for JPEG that
+        // runs the colour conversion's 4-channel kernel, which only needs
+        // SSE2.
+        int fileChannels = 0;
+        int requested = desiredChannels;
+        if (stbi_info_from_memory(bytes, (int)size, &width, &height, &fileChannels) && fileChannels == 3)
+            requested = 4;
+        stbi_set_flip_vertically_on_load_thread(true);
+        data = stbi_load_from_memory(bytes, (int)size, &width, &height, &nrChannels, requested);
+        if (data && requested)
+            nrChannels = requested;
+    }
+    bool expand = nrChannels == 3 || (desiredChannels == 4 && nrChannels != 4);
+    if (data && expand && !expandToRgba(data, nrChannels, (size_t)width * height))
+    {
+        stbi_image_free(data);
+        data = NULL;
+    }
+    return data;
+}
+
+unsigned char* decodeImage(const char* path, int& width, int& height, int& nrChannels, int desiredChannels)
+{
+    MappedFile file(path);
+    if (!file.isOpen())
+        return NULL;
+    return decodeEncodedImage(file.data(), file.size(), width, height, nrChannels, desiredChannels);
+}
+
+static bool prepareEncodedImage(const unsigned char* bytes, size_t size, const TextureLoadOptions& options,
+    PreparedTexture& image)
+{
+    if (stbi_is_hdr_from_memory(bytes, (int)size))
+        return prepareHdrTexture(bytes, size, options, image);
+    if (stbi_is_16_bit_from_memory(bytes, (int)size))
+        return prepare16BitTexture(bytes, size, options, image);
+
+    int nrChannels;
+    unsigned char* data = decodeEncodedImage(bytes, size, image.width, image.height, nrChannels, 0);
+    if (!data)
+        return false;
+    prepareDecodedTexture(data, nrChannels, options, image);
+    return true;
+}
+
+static bool prepareTextureFile(const char* path, const TextureLoadOptions& options, PreparedTexture& image)
+{
+    MappedFile file(path);
+    return file.isOpen() && prepareEncodedImage(file.data(), file.size(), options, image);
+}
+
+TextureObject loadTexture(const char* path, const TextureLoadOptions& options)
+{
+    PreparedTexture image;
+    if (!prepareTextureFile(path, options, image))
+    {
+        std::cout << "Failed to load texture: " << path << std::endl;
+        return TextureObject();
+    }
+    TextureObject texture = TextureObject::create();
+    uploadPreparedTexture(texture.id(), image);
+    return texture;
+}
+
+TextureObject loadTextureFromMemory(const unsigned char* bytes, size_t size, const TextureLoadOptions& options)
+{
+    PreparedTexture image;
+    if (!prepareEncodedImage(bytes, size, options, image))
+    {
+        std::cout << "Failed to decode texture: " << stbi_failure_reason() << std::endl;
+        return TextureObject();
+    }
+    TextureObject texture = TextureObject::create();
+    uploadPreparedTexture(texture.id(), image);
+    return texture;
+}
+
+// A file decoded for a cache entry on the thread pool.
+struct TextureCache::PendingUpload
+{
+    PreparedTexture image;
+    bool failed = false;
+    std::atomic<bool> ready{ false };
+};
+
+TextureCache::TextureCache(int edge)
+    : minEdge(std::max(edge, 1))
+{
+}
+
+size_t TextureCache::load(const char* path, const TextureLoadOptions& options)
+{
+    entries.emplace_back();
+    Entry& entry = entries.back();
+    entry.path = path;
+    entry.options = options;
+    entry.lastUsed = frame;
+    upload(entry);
+    return entries.size() - 1;
+}
+
+void TextureCache::setImage(Entry& entry, const PreparedTexture& image)
+{
+    if (!entry.texture)
+        entry.texture = TextureObject::create();
+    uploadPreparedTexture(entry.texture.id(), image);
+    entry.width = image.width;
+    entry.height = image.height;
+    entry.format = image.format;
+    entry.droppedLevels = 0;
+    entry.failed = false;
+}
+
+void TextureCache::setFailed(Entry& entry)
+{
+    std::cout << "Failed to load texture: " << entry.path << std::endl;
+    entry.texture.reset();
+    entry.failed = true;
+}
+
+bool TextureCache::upload(Entry& entry)
+{
+    entry.pending.reset();
+    PreparedTexture image;
+    if (!prepareTextureFile(entry.path.c_str(), entry.options, image))
+    {
+        setFailed(entry);
+        return false;
+    }
+    setImage(entry, image);
+    return true;
+}
+
+void TextureCache::decodeAsync(Entry& entry)
+{
+    std::shared_ptr<PendingUpload> pending = std::make_shared<PendingUpload>();
+    entry.pending = pending;
+    std::string path = entry.path;
+    TextureLoadOptions options = entry.options;
+    ThreadPool::shared().enqueue([pending, path, options]() {
+        pending->failed = !prepareTextureFile(path.c_str(), options, pending->image);
+        pending->ready.store(true, std::memory_order_release);
+    });
+}
+
+unsigned int TextureCache::use(size_t texture)
+{
+    Entry& entry = entries[texture];
+    // Evicted or shrunk textures are decoded again on the thread pool and
+    // go back up at full size on a later use(); failed ones wait for
+    // reload().
+    if (!entry.failed && (!entry.texture || entry.droppedLevels > 0))
+    {
+        if (!entry.pending)
+        {
+            decodeAsync(entry);
+        }
+        else if (entry.pending->ready.load(std::memory_order_acquire))
+        {
+            std::shared_ptr<PendingUpload> pending = std::move(entry.pending);
+            if (pending->failed)
+                setFailed(entry);
+            else
+                setImage(entry, pending->image);
+        }
+    }
+    entry.lastUsed = frame;
+    return entry.texture.id();
+}
+
+bool TextureCache::reload(size_t texture)
+{
+    Entry& entry = entries[texture];
+    entry.lastUsed = frame;
+    return upload(entry);
+}
+
+bool TextureCache::dropTopLevel(Entry& entry)
+{
+    int width = std::max(1, entry.width / 2);
+    int height = std::max(1, entry.height / 2);
+
+    // Level 1 already holds the downsampled image, so blit it into the base
+    // of a new, smaller texture; nothing comes back to the CPU. The old
+    // texture is deleted once the frame's fence has passed.
+    TextureObject smaller = TextureObject::create();
+    glBindTexture(GL_TEXTURE_2D, smaller.id());
+    glTexImage2D(GL_TEXTURE_2D, 0, entry.format.internalFormat, width, height, 0, entry.format.format,
+        entry.format.type, NULL);
+
+    if (!readFramebuffer)
+    {
+        readFramebuffer = FramebufferObject::create();
+        drawFramebuffer = FramebufferObject::create();
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer.id());
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, entry.texture.id(), 1);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer.id());
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, smaller.id(), 0);
+    bool complete = glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE &&
+        glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (complete)
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    // Detach, so the old texture's storage is not held by the framebuffer.
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // Formats that cannot be rendered to are evicted instead.
+    if (!complete)
+        return false;
+
+    int channels = entry.format.format == GL_RED ? 1 : (entry.format.format == GL_RG ? 2 : 4);
+    glBindTexture(GL_TEXTURE_2D, smaller.id());
+    finishTextureUpload(smaller.id(), channels, width, height, entry.format.internalFormat);
+
+    entry.texture = std::move(smaller);
+    entry.width = width;
+    entry.height = height;
+    entry.droppedLevels += 1;
+    return true;
+}
+
+void TextureCache::enforceBudget()
+{
+    GpuMemory& memory = GpuMemory::shared();
+    if (memory.overBudget())
+    {
+        std::vector<size_t> candidates;
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            if (entries[i].texture && entries[i].lastUsed < frame)
+                candidates.push_back(i);
+        }
+        std::sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) {
+            return entries[a].lastUsed < entries[b].lastUsed;
+        });
+
+        // Shrink the coldest texture until it hits minEdge, then evict it
+        // and move on to the next one.
+        for (size_t i = 0; i < candidates.size() && memory.overBudget(); )
+        {
+            Entry& entry = entries[candidates[i]];
+            if (std::min(entry.width, entry.height) / 2 >= minEdge && dropTopLevel(entry))
+                continue;
+            entry.texture.reset();
+            ++i;
+        }
+    }
+    ++frame;
+}
@@ -0,0 +1,137 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <glad/glad.h>
+#include "GpuResources.h"
+#include "Resample.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Number of finest mip levels to leave out; each one halves both edges.
+enum TextureQuality
+{
+    TextureQualityFull,
+    TextureQualityHalf,
+    TextureQualityQuarter
+};
+
+// Storage for HDR (Radiance) images.
+enum TextureHdrFormat
+{
+    TextureHdrHalf,        // GL_RGBA16F
+    TextureHdrR11G11B10    // GL_R11F_G11F_B10F: half the size, no alpha
+};
+
+struct TextureLoadOptions
+{
+    TextureQuality quality = TextureQualityFull;
+    // Halve further until the mip chain fits; 0 means no limit.
+    size_t maxBytes = 0;
+    ResampleFilter filter = ResampleMitchell;
+    // Multiply colour by alpha on load, for blending with
+    // GL_ONE, GL_ONE_MINUS_SRC_ALPHA.
+    bool premultiplyAlpha = false;
+    // Source channel for each of R, G, B, A of colour images; { 2, 1, 0, 3 }
+    // swaps red and blue.
+    unsigned char swizzle[4] = { 0, 1, 2, 3 };
+    TextureHdrFormat hdrFormat = TextureHdrHalf;
+};
+
+// How a texture is stored and how its texels cross the bus.
+struct TextureFormat
+{
+    GLenum internalFormat = GL_RGB;
+    GLenum format = GL_RGB;
+    GLenum type = GL_UNSIGNED_BYTE;
+};
+
+// Decodes path and uploads it with a full mip chain. When options call for
+// a smaller texture the decoded image is resampled on the CPU first, so the
+// upload and the staging memory shrink along with the VRAM. RGB images are
+// expanded to RGBA so the driver never has to repack rows; greyscale ones
+// stay GL_RED or GL_RG with a swizzle mask that samples them as grey.
+// HDR files are converted to half floats (see TextureHdrFormat) and 16-bit
+// PNGs uploaded as 16-bit unorm; premultiply and swizzle apply to 8-bit
+// images only. Returns an empty object if the file cannot be read.
+TextureObject loadTexture(const char* path, const TextureLoadOptions& options = TextureLoadOptions());
+
+// Same as loadTexture, for an encoded image already in memory.
+TextureObject loadTextureFromMemory(const unsigned char* bytes, size_t size,
+    const TextureLoadOptions& options = TextureLoadOptions());
+
+// Decodes an 8-bit image the way loadTexture does: PNGs through the fast
+// path, everything else through stb_image, bottom row first as GL expects.
+// RGB comes back expanded to RGBA, so nrChannels is 1, 2 or 4; with
+// desiredChannels 4 every image comes back RGBA. Safe on worker threads.
+// Returns NULL if the file cannot be decoded; free with stbi_image_free.
+unsigned char* decodeImage(const char* path, int& width, int& height, int& nrChannels, int desiredChannels = 0);
+
+// Swizzle mask for the texture bound to target, so 1- and 2-channel
+// images stored as GL_RED / GL_RG sample as grey and grey-alpha.
+void setTextureSwizzle(GLenum target, int nrChannels);
+
+// Textures loaded from disk under the GpuMemory budget. Once per frame,
+// enforceBudget() walks the textures not used this frame from least to
+// most recently used: each step halves one texture by copying its level 1
+// into a smaller texture on the GPU, and a texture already at minEdge is
+// evicted outright. use() queues anything degraded for a decode on the
+// thread pool and swaps the full-size texture in on a later use() once it
+// is ready; until then it hands out the degraded texture, or 0 if evicted.
+// A file that fails to load is not retried until reload() is called.
+struct PreparedTexture;
+
+class TextureCache
+{
+public:
+    explicit TextureCache(int minEdge = 64);
+
+    // Index of the new texture, which is uploaded straight away.
+    size_t load(const char* path, const TextureLoadOptions& options = TextureLoadOptions());
+
+    // GL name to bind, 0 if the file failed to load or is still being
+    // decoded after an eviction; marks the texture used this frame.
+    unsigned int use(size_t texture);
+
+    // Uploads the texture again from disk straight away, also after an
+    // earlier failure.
+    bool reload(size_t texture);
+
+    void enforceBudget();
+
+    bool isResident(size_t texture) const { return entries[texture].texture.id() != 0; }
+    int droppedLevels(size_t texture) const { return entries[texture].droppedLevels; }
+    bool failed(size_t texture) const { return entries[texture].failed; }
+    size_t size() const { return entries.size(); }
+
+private:
+    struct PendingUpload;
+
+    struct Entry
+    {
+        std::string path;
+        TextureLoadOptions options;
+        TextureObject texture;
+        int width = 0;
+        int height = 0;
+        TextureFormat format;
+        int droppedLevels = 0;
+        unsigned long long lastUsed = 0;
+        bool failed = false;
+        std::shared_ptr<PendingUpload> pending;
+    };
+
+    bool upload(Entry& entry);
+    void decodeAsync(Entry& entry);
+    void setImage(Entry& entry, const PreparedTexture& image);
+    void setFailed(Entry& entry);
+    bool dropTopLevel(Entry& entry);
+
+    std::vector<Entry> entries;
+    FramebufferObject readFramebuffer;
+    FramebufferObject drawFramebuffer;
+    unsigned long long frame = 1;
+    int minEdge;
+};
+
+#endif
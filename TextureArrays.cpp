@@ -0,0 +1,263 @@
+#include "TextureArrays.h"
+#include "GpuMemory.h"
+#include "Resample.h"
+#include "Texture.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+static GLenum channelFormat(int channels)
+{
+    return channels == 1 ? GL_RED : (channels == 2 ? GL_RG : (channels == 3 ? GL_RGB : GL_RGBA));
+}
+
+static GLenum channelInternalFormat(int channels)
+{
+    return channels == 1 ? GL_R8 : (channels == 2 ? GL_RG8 : (channels == 3 ? GL_RGB8 : GL_RGBA8));
+}
+
+TextureArrayManager::TextureArrayManager(int layers, size_t maxBytes)
+    : layersPerArray(std::max(layers, 1)), maxArrayBytes(maxBytes)
+{
+}
+
+int TextureArrayManager::maxLayers(const ArrayKey& key) const
+{
+    size_t layerBytes = textureMemorySize(std::get<0>(key), std::get<1>(key), channelFormat(std::get<2>(key)), true);
+    size_t fit = std::max(maxArrayBytes / std::max(layerBytes, (size_t)1), (size_t)1);
+    return (int)std::min(fit, (size_t)layersPerArray);
+}
+
+// Replaces entry's texture with empty storage for capacity layers.
+void TextureArrayManager::allocateStorage(ArrayEntry& entry, int capacity)
+{
+    int width = std::get<0>(entry.key);
+    int height = std::get<1>(entry.key);
+    int channels = std::get<2>(entry.key);
+
+    entry.texture = TextureObject::create();
+    entry.capacity = capacity;
+    entry.levels = 0;
+    if (entry.generations.size() < (size_t)capacity)
+        entry.generations.resize(capacity, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, entry.texture.id());
+    for (int levelWidth = width, levelHeight = height; ; levelWidth = std::max(1, levelWidth / 2), levelHeight = std::max(1, levelHeight / 2))
+    {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, entry.levels, channelInternalFormat(channels), levelWidth, levelHeight,
+            capacity, 0, channelFormat(channels), GL_UNSIGNED_BYTE, NULL);
+        entry.levels += 1;
+        if (levelWidth == 1 && levelHeight == 1)
+            break;
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, entry.levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    setTextureSwizzle(GL_TEXTURE_2D_ARRAY, channels);
+    GpuMemory::shared().record(GpuTexture, entry.texture.id(), GpuMemoryTextures,
+        textureMemorySize(width, height, channelFormat(channels), true) * capacity);
+}
+
+unsigned int TextureArrayManager::createArray(const ArrayKey& key)
+{
+    unsigned int index = (unsigned int)arrays.size();
+    for (unsigned int i = 0; i < arrays.size(); ++i)
+    {
+        if (!arrays[i].texture)
+        {
+            index = i;
+            break;
+        }
+    }
+    if (index == arrays.size())
+        arrays.emplace_back();
+
+    // Start small: a 4096x4096 RGBA layer with mips is ~90 MB, and most
+    // sizes only ever see a handful of textures.
+    ArrayEntry& entry = arrays[index];
+    entry.key = key;
+    entry.used = 0;
+    entry.freeLayers.clear();
+    allocateStorage(entry, std::min(4, maxLayers(key)));
+    for (int layer = entry.capacity - 1; layer >= 0; --layer)
+        entry.freeLayers.push_back((unsigned int)layer);
+
+    groups[key].push_back(index);
+    return index;
+}
+
+// Doubles a full array. Every level of the old layers goes through a pixel
+// buffer, so the copy stays on the GPU.
+void TextureArrayManager::growArray(ArrayEntry& entry)
+{
+    int width = std::get<0>(entry.key);
+    int height = std::get<1>(entry.key);
+    GLenum format = channelFormat(std::get<2>(entry.key));
+    int oldCapacity = entry.capacity;
+    TextureObject old = std::move(entry.texture);
+    allocateStorage(entry, std::min(oldCapacity * 2, maxLayers(entry.key)));
+
+    BufferObject staging = BufferObject::create();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, staging.id());
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.id());
+    glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)width * height * std::get<2>(entry.key) * oldCapacity, NULL, GL_STREAM_COPY);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    int levelWidth = width;
+    int levelHeight = height;
+    for (int level = 0; level < entry.levels; ++level)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, old.id());
+        glGetTexImage(GL_TEXTURE_2D_ARRAY, level, format, GL_UNSIGNED_BYTE, (void*)0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, entry.texture.id());
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, levelWidth, levelHeight, oldCapacity, format,
+            GL_UNSIGNED_BYTE, (void*)0);
+        levelWidth = std::max(1, levelWidth / 2);
+        levelHeight = std::max(1, levelHeight / 2);
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    for (int layer = entry.capacity - 1; layer >= oldCapacity; --layer)
+        entry.freeLayers.push_back((unsigned int)layer);
+}
+
+TextureLayer TextureArrayManager::add(const unsigned char* pixels, int width, int height, int channels)
+{
+    ArrayKey key(width, height, channels);
+    std::vector<unsigned int>& group = groups[key];
+    unsigned int array = ~0u;
+    for (unsigned int candidate : group)
+    {
+        if (!arrays[candidate].freeLayers.empty())
+        {
+            array = candidate;
+            break;
+        }
+    }
+    if (array == ~0u)
+    {
+        int limit = maxLayers(key);
+        for (unsigned int candidate : group)
+        {
+            if (arrays[candidate].capacity < limit)
+            {
+                array = candidate;
+                growArray(arrays[array]);
+                break;
+            }
+        }
+    }
+    if (array == ~0u)
+        array = createArray(key);
+
+    ArrayEntry& entry = arrays[array];
+    TextureLayer result;
+    result.array = array;
+    result.layer = entry.freeLayers.back();
+    result.generation = ++entry.generations[result.layer];
+    entry.freeLayers.pop_back();
+    entry.used += 1;
+
+    GLenum format = channelFormat(channels);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, entry.texture.id());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, result.layer, width, height, 1, format, GL_UNSIGNED_BYTE, pixels);
+
+    // Only this layer's chain is built; glGenerateMipmap would redo every
+    // layer in the array.
+    std::vector<unsigned char> previous;
+    std::vector<unsigned char> next;
+    const unsigned char* source = pixels;
+    int levelWidth = width;
+    int levelHeight = height;
+    for (int level = 1; level < entry.levels; ++level)
+    {
+        int nextWidth = std::max(1, levelWidth / 2);
+        int nextHeight = std::max(1, levelHeight / 2);
+        next.resize((size_t)nextWidth * nextHeight * channels);
+        resampleImage(source, levelWidth, levelHeight, channels, next.data(), nextWidth, nextHeight);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, result.layer, nextWidth, nextHeight, 1, format,
+            GL_UNSIGNED_BYTE, next.data());
+        previous.swap(next);
+        source = previous.data();
+        levelWidth = nextWidth;
+        levelHeight = nextHeight;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    return result;
+}
+
+TextureLayer TextureArrayManager::load(const char* path)
+{
+    int width, height, channels;
+    unsigned char* data = decodeImage(path, width, height, channels);
+    if (!data)
+    {
+        std::cout << "Failed to load texture: " << path << std::endl;
+        return TextureLayer();
+    }
+    TextureLayer layer = add(data, width, height, channels);
+    stbi_image_free(data);
+    return layer;
+}
+
+void TextureArrayManager::release(TextureLayer layer)
+{
+    if (layer.isNull() || layer.array >= arrays.size() || !arrays[layer.array].texture)
+        return;
+    ArrayEntry& entry = arrays[layer.array];
+    if (layer.layer >= entry.generations.size() || entry.generations[layer.layer] != layer.generation)
+        return;
+
+    entry.generations[layer.layer] += 1;
+    assert(entry.used > 0);
+    entry.freeLayers.push_back(layer.layer);
+    entry.used -= 1;
+    if (entry.used > 0)
+        return;
+
+    std::vector<unsigned int>& group = groups[entry.key];
+    if (group.size() > 1)
+    {
+        group.erase(std::find(group.begin(), group.end(), layer.array));
+        entry.texture.reset();
+        entry.freeLayers.clear();
+    }
+}
+
+void TextureArrayManager::bind(TextureLayer layer, unsigned int unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, arrayTexture(layer));
+}
+
+size_t TextureArrayManager::arrayCount() const
+{
+    size_t count = 0;
+    for (const ArrayEntry& entry : arrays)
+        count += entry.texture ? 1 : 0;
+    return count;
+}
+
+size_t TextureArrayManager::layerCount() const
+{
+    size_t count = 0;
+    for (const ArrayEntry& entry : arrays)
+        count += entry.texture ? entry.used : 0;
+    return count;
+}
+
+void setupInstanceLayers(unsigned int vao, unsigned int buffer, unsigned int location)
+{
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribPointer(location, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+    glVertexAttribDivisor(location, 1);
+    glEnableVertexAttribArray(location);
+    glBindVertexArray(0);
+}
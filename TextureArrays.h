@@ -0,0 +1,75 @@
+#ifndef TEXTURE_ARRAYS_H
+#define TEXTURE_ARRAYS_H
+
+#include <glad/glad.h>
+#include "GpuResources.h"
+#include <map>
+#include <tuple>
+#include <vector>
+
+// A layer handle; generation changes every time the layer is handed out
+// or released, so a stale or repeated release() is ignored.
+struct TextureLayer
+{
+    unsigned int array = ~0u;
+    unsigned int layer = 0;
+    unsigned int generation = 0;
+
+    bool isNull() const { return array == ~0u; }
+};
+
+// Packs textures of the same size and format into GL_TEXTURE_2D_ARRAY
+// objects so draws that differ only in texture can share one array and be
+// batched, picking the layer per vertex or per instance (3.3.array.vs).
+// Mip chains are built on the CPU so adding a layer never regenerates the
+// others. An array starts with a few layers and doubles, copying its
+// layers on the GPU, up to layersPerArray or as many as fit in
+// maxArrayBytes. Released layers are reused; an array left empty is freed
+// unless it is the last one of its size and format.
+class TextureArrayManager
+{
+public:
+    explicit TextureArrayManager(int layersPerArray = 32, size_t maxArrayBytes = (size_t)256 << 20);
+
+    // pixels is tightly packed with channels (1 to 4) per texel; 1- and
+    // 2-channel arrays sample as grey and grey-alpha.
+    TextureLayer add(const unsigned char* pixels, int width, int height, int channels);
+    TextureLayer load(const char* path);
+    void release(TextureLayer layer);
+
+    // 0 for a null layer.
+    unsigned int arrayTexture(TextureLayer layer) const { return layer.isNull() ? 0 : arrays[layer.array].texture.id(); }
+    void bind(TextureLayer layer, unsigned int unit) const;
+
+    size_t arrayCount() const;
+    size_t layerCount() const;
+
+private:
+    typedef std::tuple<int, int, int> ArrayKey;    // width, height, channels
+
+    struct ArrayEntry
+    {
+        TextureObject texture;
+        ArrayKey key;
+        int levels = 0;
+        int capacity = 0;
+        std::vector<unsigned int> freeLayers;
+        std::vector<unsigned int> generations;    // per layer; kept when the entry is reused
+        int used = 0;
+    };
+
+    unsigned int createArray(const ArrayKey& key);
+    void allocateStorage(ArrayEntry& entry, int capacity);
+    void growArray(ArrayEntry& entry);
+    int maxLayers(const ArrayKey& key) const;
+
+    int layersPerArray;
+    size_t maxArrayBytes;
+    std::vector<ArrayEntry> arrays;
+    std::map<ArrayKey, std::vector<unsigned int>> groups;
+};
+
+// Per-instance float layer index on location, read from buffer.
+void setupInstanceLayers(unsigned int vao, unsigned int buffer, unsigned int location = 4);
+
+#endif
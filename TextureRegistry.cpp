@@ -0,0 +1,117 @@
+#include "TextureRegistry.h"
+#include "Hash.h"
+#include <cstring>
+#include <iostream>
+
+unsigned long long TextureRegistry::optionsKey(const TextureLoadOptions& options)
+{
+    unsigned long long swizzle = options.swizzle[0] | (options.swizzle[1] << 8) | (options.swizzle[2] << 16) |
+        ((unsigned long long)options.swizzle[3] << 24);
+    unsigned long long fields[6] = { (unsigned long long)options.quality, (unsigned long long)options.maxBytes,
+        (unsigned long long)options.filter, (unsigned long long)options.premultiplyAlpha, swizzle,
+        (unsigned long long)options.hdrFormat };
+    return hashBytes(fields, sizeof(fields));
+}
+
+TextureRegistry::Entry* TextureRegistry::find(GpuHandle<GpuTexture> texture)
+{
+    auto it = entries.find(texture.index);
+    if (it == entries.end() || it->second.texture.handle() != texture)
+        return nullptr;
+    return &it->second;
+}
+
+bool TextureRegistry::sameContents(const Entry& entry, const MappedFile& file)
+{
+    MappedFile original(entry.source.c_str());
+    if (!original.isOpen() || original.size() != file.size())
+        return false;
+    counters.bytesCompared += file.size();
+    return memcmp(original.data(), file.data(), file.size()) == 0;
+}
+
+GpuHandle<GpuTexture> TextureRegistry::addReference(Entry& entry)
+{
+    ++entry.references;
+    return entry.texture.handle();
+}
+
+GpuHandle<GpuTexture> TextureRegistry::acquire(const char* path, const TextureLoadOptions& options)
+{
+    ++counters.requests;
+    unsigned long long settings = optionsKey(options);
+    PathKey pathKey(path, settings);
+
+    auto named = byPath.find(pathKey);
+    if (named != byPath.end())
+    {
+        ++counters.pathHits;
+        return addReference(entries[named->second]);
+    }
+
+    MappedFile file(path);
+    if (!file.isOpen())
+    {
+        std::cout << "Failed to load texture: " << path << std::endl;
+        return GpuHandle<GpuTexture>();
+    }
+
+    // Seeding with the options keeps differently decoded copies apart.
+    unsigned long long contentKey = hashBytes(file.data(), file.size(), settings);
+    counters.bytesHashed += file.size();
+
+    // A colliding or since-changed file falls through to its own decode.
+    auto same = byContent.find(contentKey);
+    if (same != byContent.end() && sameContents(entries[same->second], file))
+    {
+        ++counters.contentHits;
+        Entry& entry = entries[same->second];
+        entry.paths.push_back(pathKey);
+        byPath[pathKey] = same->second;
+        return addReference(entry);
+    }
+
+    // loadTextureFromMemory reports its own failures.
+    TextureObject texture = loadTextureFromMemory(file.data(), file.size(), options);
+    if (!texture)
+        return GpuHandle<GpuTexture>();
+    ++counters.decodes;
+
+    unsigned int slot = texture.handle().index;
+    Entry& entry = entries[slot];
+    entry.texture = std::move(texture);
+    entry.contentKey = contentKey;
+    entry.source = path;
+    entry.paths.push_back(pathKey);
+    byPath[pathKey] = slot;
+    // On a mismatch the newest file takes the key over; the older entry's
+    // source has changed or collides, so it is the worse one to match.
+    byContent[contentKey] = slot;
+    counters.live = entries.size();
+    return addReference(entry);
+}
+
+void TextureRegistry::release(GpuHandle<GpuTexture> texture)
+{
+    Entry* entry = find(texture);
+    if (!entry || --entry->references > 0)
+        return;
+
+    for (const PathKey& key : entry->paths)
+        byPath.erase(key);
+    auto content = byContent.find(entry->contentKey);
+    if (content != byContent.end() && content->second == texture.index)
+        byContent.erase(content);
+    // Erasing the entry resets its TextureObject, which queues the GL
+    // texture for deferred deletion.
+    entries.erase(texture.index);
+    counters.live = entries.size();
+}
+
+int TextureRegistry::refCount(GpuHandle<GpuTexture> texture) const
+{
+    auto it = entries.find(texture.index);
+    if (it == entries.end() || it->second.texture.handle() != texture)
+        return 0;
+    return it->second.references;
+}
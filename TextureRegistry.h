@@ -0,0 +1,74 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include "GpuResources.h"
+#include "MappedFile.h"
+#include "Texture.h"
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct TextureRegistryStats
+{
+    size_t requests = 0;
+    size_t pathHits = 0;       // same path and options as a live texture
+    size_t contentHits = 0;    // new path, but identical file contents
+    size_t decodes = 0;
+    size_t bytesHashed = 0;
+    size_t bytesCompared = 0;  // checking hash matches byte for byte
+    size_t live = 0;
+};
+
+// Shared, refcounted textures. A path already loaded with the same options
+// is found by name without touching the file. Otherwise the file is mapped
+// and its compressed bytes hashed (XXH64); copies of an image under other
+// names reuse the existing texture instead of decoding and uploading again.
+// A hash match is only shared once the bytes compare equal to the file the
+// texture was loaded from.
+// Decode options are mixed into both keys, since they change the result.
+class TextureRegistry
+{
+public:
+    TextureRegistry() = default;
+    TextureRegistry(const TextureRegistry&) = delete;
+    TextureRegistry& operator=(const TextureRegistry&) = delete;
+
+    // Takes one reference; null handle if the file cannot be loaded.
+    GpuHandle<GpuTexture> acquire(const char* path, const TextureLoadOptions& options = TextureLoadOptions());
+
+    // Drops one reference; the texture is released with the last one.
+    void release(GpuHandle<GpuTexture> texture);
+
+    unsigned int get(GpuHandle<GpuTexture> texture) const { return GpuResources::shared().get(texture); }
+    int refCount(GpuHandle<GpuTexture> texture) const;
+
+    const TextureRegistryStats& stats() const { return counters; }
+
+private:
+    typedef std::pair<std::string, unsigned long long> PathKey;
+
+    struct Entry
+    {
+        TextureObject texture;
+        unsigned long long contentKey = 0;
+        std::string source;    // file the texture was decoded from
+        std::vector<PathKey> paths;
+        int references = 0;
+    };
+
+    static unsigned long long optionsKey(const TextureLoadOptions& options);
+    Entry* find(GpuHandle<GpuTexture> texture);
+    bool sameContents(const Entry& entry, const MappedFile& file);
+    GpuHandle<GpuTexture> addReference(Entry& entry);
+
+    // Entries are keyed by pool slot; the handle's generation is checked
+    // against the entry's own texture on every lookup.
+    std::unordered_map<unsigned int, Entry> entries;
+    std::map<PathKey, unsigned int> byPath;
+    std::unordered_map<unsigned long long, unsigned int> byContent;
+    TextureRegistryStats counters;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "TextureStreamer.h"
+#include "GpuMemory.h"
+#include "Resample.h"
+#include "Texture.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+TextureStreamer::TextureStreamer(size_t frameBudgetBytes, int edge, ThreadPool* threadPool)
+    : frameBudget(frameBudgetBytes), tailEdge(std::max(edge, 1)), pool(threadPool)
+{
+}
+
+TextureStreamer::DecodedImage::~DecodedImage()
+{
+    stbi_image_free(pixels);
+}
+
+void TextureStreamer::decode(const std::string& path, int tailEdge, DecodedImage& image)
+{
+    image.pixels = decodeImage(path.c_str(), image.width, image.height, image.channels);
+    if (!image.pixels || tailEdge == 0)
+    {
+        image.failed = !image.pixels;
+        image.ready.store(true, std::memory_order_release);
+        return;
+    }
+
+    int maxLevel = 0;
+    while ((image.width >> maxLevel) > 1 || (image.height >> maxLevel) > 1)
+        ++maxLevel;
+    int tail = 0;
+    while (tail < maxLevel && std::max(image.width >> tail, image.height >> tail) > tailEdge)
+        ++tail;
+    image.tailLevel = tail;
+
+    // The first tail level comes straight from the decode, the rest from
+    // the level before.
+    const unsigned char* source = image.pixels;
+    int width = image.width;
+    int height = image.height;
+    for (int level = tail; level <= maxLevel; ++level)
+    {
+        int levelWidth = std::max(1, image.width >> level);
+        int levelHeight = std::max(1, image.height >> level);
+        std::vector<unsigned char> pixels((size_t)levelWidth * levelHeight * image.channels);
+        resampleImage(source, width, height, image.channels, pixels.data(), levelWidth, levelHeight);
+        image.tail.push_back(std::move(pixels));
+        source = image.tail.back().data();
+        width = levelWidth;
+        height = levelHeight;
+    }
+    image.ready.store(true, std::memory_order_release);
+}
+
+void TextureStreamer::buildLevel(DecodedImage& image, int level)
+{
+    int width = std::max(1, image.width >> level);
+    int height = std::max(1, image.height >> level);
+    image.level.resize((size_t)width * height * image.channels);
+    resampleImage(image.pixels, image.width, image.height, image.channels, image.level.data(), width, height);
+    image.levelReady.store(true, std::memory_order_release);
+}
+
+size_t TextureStreamer::request(const char* path)
+{
+    streams.emplace_back();
+    Stream& stream = streams.back();
+    stream.path = path;
+    stream.texture = TextureObject::create();
+
+    const unsigned char grey[4] = { 128, 128, 128, 255 };
+    glBindTexture(GL_TEXTURE_2D, stream.texture.id());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    stream.residentBytes = 4;
+    GpuMemory::shared().record(GpuTexture, stream.texture.id(), GpuMemoryTextures, stream.residentBytes);
+
+    decodeAsync(stream);
+    return streams.size() - 1;
+}
+
+void TextureStreamer::decodeAsync(Stream& stream)
+{
+    stream.image = std::make_shared<DecodedImage>();
+    std::shared_ptr<DecodedImage> image = stream.image;
+    std::string file = stream.path;
+    int edge = stream.baseLevel < 0 ? tailEdge : 0;
+    pool->enqueue([file, edge, image]() { decode(file, edge, *image); });
+}
+
+void TextureStreamer::requestLevel(Stream& stream, int level)
+{
+    std::shared_ptr<DecodedImage> image = stream.image;
+    image->levelIndex = level;
+    image->levelReady.store(false, std::memory_order_relaxed);
+    pool->enqueue([image, level]() { buildLevel(*image, level); });
+}
+
+size_t TextureStreamer::uploadLevel(Stream& stream, int level, const unsigned char* pixels)
+{
+    int width = std::max(1, stream.width >> level);
+    int height = std::max(1, stream.height >> level);
+    glTexImage2D(GL_TEXTURE_2D, level, stream.format, width, height, 0, stream.format, GL_UNSIGNED_BYTE, pixels);
+    stream.residentBytes += textureMemorySize(width, height, stream.format, false);
+    return (size_t)width * height * stream.image->channels;
+}
+
+void TextureStreamer::uploadTail(Stream& stream)
+{
+    // The tail is small enough to go up in one piece regardless of the
+    // budget, replacing the placeholder.
+    DecodedImage& image = *stream.image;
+    int tail = image.tailLevel;
+    int maxLevel = tail + (int)image.tail.size() - 1;
+    stream.width = image.width;
+    stream.height = image.height;
+    static const GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    stream.format = formats[image.channels - 1];
+    stream.residentBytes = 0;
+    setTextureSwizzle(GL_TEXTURE_2D, image.channels);
+
+    for (int level = maxLevel; level >= tail; --level)
+        uploadLevel(stream, level, image.tail[level - tail].data());
+    // The CPU copies are not needed once the levels are resident.
+    std::vector<std::vector<unsigned char>>().swap(image.tail);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, tail);
+    stream.baseLevel = tail;
+    stream.tailLevel = tail;
+}
+
+void TextureStreamer::releaseLevels(Stream& stream, int level)
+{
+    // Redefining a level as 0x0 frees its storage; it sits below the base
+    // level, so completeness is unaffected.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    for (int finer = stream.baseLevel; finer < level; ++finer)
+    {
+        glTexImage2D(GL_TEXTURE_2D, finer, stream.format, 0, 0, 0, stream.format, GL_UNSIGNED_BYTE, NULL);
+        int width = std::max(1, stream.width >> finer);
+        int height = std::max(1, stream.height >> finer);
+        stream.residentBytes -= textureMemorySize(width, height, stream.format, false);
+    }
+    stream.baseLevel = level;
+}
+
+void TextureStreamer::update()
+{
+    size_t budget = frameBudget;
+    bool uploaded = false;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (Stream& stream : streams)
+    {
+        if (stream.failed)
+            continue;
+
+        bool ready = stream.image && stream.image->ready.load(std::memory_order_acquire);
+        if (ready && stream.image->failed)
+        {
+            std::cout << "Failed to load texture: " << stream.path << std::endl;
+            stream.failed = true;
+            stream.image.reset();
+            continue;
+        }
+
+        size_t residentBefore = stream.residentBytes;
+        if (stream.baseLevel < 0)
+        {
+            if (!ready)
+                continue;
+            glBindTexture(GL_TEXTURE_2D, stream.texture.id());
+            uploadTail(stream);
+            uploaded = true;
+        }
+
+        int target = std::min(std::max(stream.requiredLevel, 0), stream.tailLevel);
+        if (stream.baseLevel > target)
+        {
+            if (!stream.image)
+                decodeAsync(stream);
+
+            // Always let one level through per frame so a level larger
+            // than the whole budget still lands eventually. Level 0 is the
+            // decode itself; the others are built on a worker first.
+            while (ready && stream.baseLevel > target)
+            {
+                DecodedImage& image = *stream.image;
+                int level = stream.baseLevel - 1;
+                const unsigned char* pixels = image.pixels;
+                if (level > 0)
+                {
+                    if (image.levelIndex != level)
+                        requestLevel(stream, level);
+                    if (!image.levelReady.load(std::memory_order_acquire))
+                        break;
+                    pixels = image.level.data();
+                }
+                size_t bytes = (size_t)std::max(1, stream.width >> level) * std::max(1, stream.height >> level) *
+                    image.channels;
+                if (bytes > budget && uploaded)
+                    break;
+                glBindTexture(GL_TEXTURE_2D, stream.texture.id());
+                uploadLevel(stream, level, pixels);
+                if (level > 0)
+                    std::vector<unsigned char>().swap(image.level);
+                budget -= std::min(budget, bytes);
+                uploaded = true;
+                stream.baseLevel = level;
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+            }
+        }
+        else if (stream.baseLevel + 1 < target)
+        {
+            glBindTexture(GL_TEXTURE_2D, stream.texture.id());
+            releaseLevels(stream, target);
+        }
+
+        if (ready && stream.baseLevel <= target)
+            stream.image.reset();
+        if (stream.residentBytes != residentBefore)
+            GpuMemory::shared().record(GpuTexture, stream.texture.id(), GpuMemoryTextures, stream.residentBytes);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
@@ -0,0 +1,107 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+#include "GpuResources.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Progressive texture loading. request() returns at once with a bindable
+// 1x1 placeholder while a worker decodes the file (through decodeImage, so
+// RGB arrives as RGBA) and builds its mip tail (every level up to
+// tailEdge). update() then uploads the tail in one go and clamps
+// GL_TEXTURE_BASE_LEVEL to it, and on later frames adds one finer level at
+// a time while the frame's byte budget allows. Each finer level is
+// resampled from the decode on a worker only when its turn comes, so no
+// more than one of them is held in memory. The first frame never waits on
+// a decode or a full-size upload.
+//
+// Streaming stops at each texture's required level (0 unless a residency
+// manager says otherwise). When the required level moves two or more levels
+// coarser, the finer levels are released. Moving finer again decodes the
+// file once more, since CPU copies are dropped once uploaded, but the
+// resident levels and the tail are kept: only the missing levels are
+// rebuilt and uploaded.
+class TextureStreamer
+{
+public:
+    explicit TextureStreamer(size_t frameBudgetBytes = 4u << 20, int tailEdge = 64, ThreadPool* pool = &ThreadPool::shared());
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    size_t request(const char* path);
+
+    // Call once per frame on the GL thread.
+    void update();
+
+    // Finest level worth keeping resident; clamped to the mip tail.
+    void setRequiredLevel(size_t stream, int level) { streams[stream].requiredLevel = level; }
+
+    size_t size() const { return streams.size(); }
+    unsigned int texture(size_t stream) const { return streams[stream].texture.id(); }
+    // Full-size dimensions; 0 until the decode has finished.
+    int width(size_t stream) const { return streams[stream].width; }
+    int height(size_t stream) const { return streams[stream].height; }
+    // Finest level resident so far, or -1 while only the placeholder is.
+    int residentLevel(size_t stream) const { return streams[stream].baseLevel; }
+    bool isComplete(size_t stream) const { return streams[stream].baseLevel == 0; }
+    bool hasFailed(size_t stream) const { return streams[stream].failed; }
+
+private:
+    struct DecodedImage
+    {
+        ~DecodedImage();
+
+        unsigned char* pixels = nullptr;    // level 0, from decodeImage
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        bool failed = false;
+        std::atomic<bool> ready{ false };
+
+        // Levels tailLevel and coarser, built along with the decode.
+        std::vector<std::vector<unsigned char>> tail;
+        int tailLevel = 0;
+
+        // The one finer level being built; written by the worker until
+        // levelReady is set.
+        std::vector<unsigned char> level;
+        int levelIndex = -1;
+        std::atomic<bool> levelReady{ false };
+    };
+
+    struct Stream
+    {
+        std::string path;
+        TextureObject texture;
+        std::shared_ptr<DecodedImage> image;
+        GLenum format = GL_RGBA;
+        int width = 0;
+        int height = 0;
+        int baseLevel = -1;
+        int tailLevel = 0;
+        int requiredLevel = 0;
+        bool failed = false;
+        size_t residentBytes = 0;
+    };
+
+    // tailEdge 0 skips the tail, for streams that already have theirs.
+    static void decode(const std::string& path, int tailEdge, DecodedImage& image);
+    static void buildLevel(DecodedImage& image, int level);
+    void decodeAsync(Stream& stream);
+    void requestLevel(Stream& stream, int level);
+    void uploadTail(Stream& stream);
+    size_t uploadLevel(Stream& stream, int level, const unsigned char* pixels);
+    void releaseLevels(Stream& stream, int level);
+
+    std::vector<Stream> streams;
+    size_t frameBudget;
+    int tailEdge;
+    ThreadPool* pool;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount == 0)
+    {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threadCount = hardware > 1 ? hardware - 1 : 1;
+    }
+    for (unsigned int i = 0; i < threadCount; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (taskCount < taskCapacity)
+        {
+            tasks[(taskHead + taskCount) % taskCapacity] = std::move(task);
+            ++taskCount;
+            task = nullptr;
+        }
+    }
+    if (task)
+    {
+        task();
+        return;
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || helperRequests > 0 || taskCount > 0; });
+            if (helperRequests > 0)
+            {
+                --helperRequests;
+                ++activeHelpers;
+            }
+            else if (taskCount > 0)
+            {
+                task.swap(tasks[taskHead]);
+                taskHead = (taskHead + 1) % taskCapacity;
+                --taskCount;
+            }
+            else
+            {
+                return;
+            }
+        }
+        if (task)
+        {
+            task();
+            continue;
+        }
+
+        drainBatch();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--activeHelpers == 0)
+            batchDone.notify_all();
+    }
+}
+
+void ThreadPool::drainBatch()
+{
+    for (;;)
+    {
+        size_t chunk = nextChunk.fetch_add(1);
+        if (chunk >= chunkCount)
+            return;
+        size_t begin = batchCount * chunk / chunkCount;
+        size_t end = batchCount * (chunk + 1) / chunkCount;
+        batchFunction(batchBody, begin, end);
+    }
+}
+
+void ThreadPool::runBatch(size_t count, RangeFunction function, const void* body, size_t minChunk)
+{
+    if (count == 0)
+        return;
+
+    size_t maxChunks = (size_t)(workers.size() + 1) * 4;
+    size_t chunks = std::min(maxChunks, std::max<size_t>(1, count / std::max<size_t>(minChunk, 1)));
+    if (chunks == 1 || batchBusy.exchange(true))
+    {
+        function(body, 0, count);
+        return;
+    }
+
+    batchFunction = function;
+    batchBody = body;
+    batchCount = count;
+    chunkCount = chunks;
+    nextChunk = 0;
+
+    size_t helpers = std::min<size_t>(workers.size(), chunks - 1);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        helperRequests = helpers;
+    }
+    for (size_t i = 0; i < helpers; ++i)
+        wake.notify_one();
+
+    drainBatch();
+
+    // Withdraw requests no worker picked up, then wait for the helpers that
+    // did so the batch fields can be reused by the next call.
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        helperRequests = 0;
+        batchDone.wait(lock, [this] { return activeHelpers == 0; });
+    }
+    batchBusy = false;
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
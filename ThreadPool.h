@@ -0,0 +1,78 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    // threadCount == 0 uses one worker per hardware thread minus the caller.
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int workerCount() const { return (unsigned int)workers.size(); }
+
+    // Tasks go into a fixed ring; when it is full the task runs on the
+    // calling thread instead.
+    void enqueue(std::function<void()> task);
+
+    // Splits [0, count) into chunks of at least minChunk items and runs
+    // body(begin, end) on them. The calling thread takes chunks as well and
+    // the call returns once every chunk has finished. Nothing is allocated:
+    // body is called through a pointer and the batch state is a member, so
+    // a second batch started while one is running (from another thread or
+    // from inside body) runs on its caller alone.
+    template <typename Body>
+    void parallelFor(size_t count, const Body& body, size_t minChunk = 1)
+    {
+        runBatch(count, &callRange<Body>, &body, minChunk);
+    }
+
+    static ThreadPool& shared();
+
+private:
+    typedef void (*RangeFunction)(const void* body, size_t begin, size_t end);
+
+    template <typename Body>
+    static void callRange(const void* body, size_t begin, size_t end)
+    {
+        (*static_cast<const Body*>(body))(begin, end);
+    }
+
+    void runBatch(size_t count, RangeFunction function, const void* body, size_t minChunk);
+    void drainBatch();
+    void workerLoop();
+
+    static const size_t taskCapacity = 256;
+
+    std::vector<std::thread> workers;
+    std::function<void()> tasks[taskCapacity];
+    size_t taskHead = 0;
+    size_t taskCount = 0;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    // The one batch in flight. helperRequests and activeHelpers are guarded
+    // by mutex; the rest is written only while no helper is active.
+    std::atomic<bool> batchBusy{false};
+    RangeFunction batchFunction = nullptr;
+    const void* batchBody = nullptr;
+    size_t batchCount = 0;
+    size_t chunkCount = 0;
+    std::atomic<size_t> nextChunk{0};
+    size_t helperRequests = 0;
+    size_t activeHelpers = 0;
+    std::condition_variable batchDone;
+};
+
+#endif
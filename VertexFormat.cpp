@@ -0,0 +1,34 @@
+#include "VertexFormat.h"
+
+unsigned int vertexFormatStride(VertexFormat format)
+{
+    return withVertexLayout(format, [](auto layout) { return decltype(layout)::stride; });
+}
+
+void packVertices(const Vertex* vertices, size_t count, VertexFormat format, std::vector<unsigned char>& out)
+{
+    // Deinterleave into SoA streams so each attribute goes through one bulk
+    // SIMD conversion inside the layout's pack routine.
+    std::vector<float> positions(count * 3);
+    std::vector<float> colors(count * 3);
+    std::vector<float> texCoords(count * 2);
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::memcpy(&positions[i * 3], vertices[i].position, sizeof(vertices[i].position));
+        std::memcpy(&colors[i * 3], vertices[i].color, sizeof(vertices[i].color));
+        std::memcpy(&texCoords[i * 2], vertices[i].texCoord, sizeof(vertices[i].texCoord));
+    }
+
+    const float* streams[] = { positions.data(), colors.data(), texCoords.data() };
+    withVertexLayout(format, [&](auto layout) { decltype(layout)::packAoS(streams, count, out); });
+}
+
+void setupVertexAttributes(VertexFormat format)
+{
+    withVertexLayout(format, [](auto layout) { decltype(layout)::apply(); });
+}
+
+bool vertexFormatMatchesProgram(VertexFormat format, unsigned int program)
+{
+    return withVertexLayout(format, [program](auto layout) { return decltype(layout)::matchesProgram(program); });
+}
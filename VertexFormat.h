@@ -0,0 +1,66 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+#include "VertexLayout.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Vertex
+{
+    float position[3];
+    float color[3];
+    float texCoord[2];
+};
+
+// VertexFloat:    32 bytes, everything GL_FLOAT.
+// VertexHalf:     16 bytes, half positions, unorm8 colors, half UVs.
+// VertexSnorm16:  16 bytes, snorm16 positions (must lie in [-1, 1]),
+//                 unorm8 colors, half UVs.
+enum VertexFormat { VertexFloat, VertexHalf, VertexSnorm16 };
+
+struct CompactVertex
+{
+    uint16_t position[4];
+    uint8_t color[4];
+    uint16_t texCoord[2];
+};
+
+using FloatVertexLayout = VertexLayout<
+    VertexAttribute<0, GL_FLOAT, 3>,
+    VertexAttribute<1, GL_FLOAT, 3>,
+    VertexAttribute<2, GL_FLOAT, 2>>;
+
+using HalfVertexLayout = VertexLayout<
+    VertexAttribute<0, GL_HALF_FLOAT, 3, false, 4>,
+    VertexAttribute<1, GL_UNSIGNED_BYTE, 3, true, 4>,
+    VertexAttribute<2, GL_HALF_FLOAT, 2>>;
+
+using Snorm16VertexLayout = VertexLayout<
+    VertexAttribute<0, GL_SHORT, 3, true, 4>,
+    VertexAttribute<1, GL_UNSIGNED_BYTE, 3, true, 4>,
+    VertexAttribute<2, GL_HALF_FLOAT, 2>>;
+
+static_assert(FloatVertexLayout::stride == sizeof(Vertex), "float layout must match Vertex");
+static_assert(HalfVertexLayout::stride == sizeof(CompactVertex), "half layout must match CompactVertex");
+static_assert(Snorm16VertexLayout::stride == sizeof(CompactVertex), "snorm16 layout must match CompactVertex");
+
+// Calls fn with a default-constructed layout object for the runtime format.
+template <typename Fn>
+decltype(auto) withVertexLayout(VertexFormat format, Fn&& fn)
+{
+    switch (format)
+    {
+    case VertexHalf: return fn(HalfVertexLayout{});
+    case VertexSnorm16: return fn(Snorm16VertexLayout{});
+    default: return fn(FloatVertexLayout{});
+    }
+}
+
+unsigned int vertexFormatStride(VertexFormat format);
+void packVertices(const Vertex* vertices, size_t count, VertexFormat format, std::vector<unsigned char>& out);
+void setupVertexAttributes(VertexFormat format);
+bool vertexFormatMatchesProgram(VertexFormat format, unsigned int program);
+
+#endif
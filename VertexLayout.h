@@ -0,0 +1,226 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <glad/glad.h>
+#include "SimdConvert.h"
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Vertex layouts declared as types. Stride, offsets and the GL attribute
+// setup are computed at compile time from the attribute list, e.g.
+//
+//   using Layout = VertexLayout<VertexAttribute<0, GL_FLOAT, 3>,
+//                               VertexAttribute<1, GL_UNSIGNED_BYTE, 3, true, 4>>;
+//
+// StorageComponents pads an attribute in memory (a 3 component unorm8 color
+// stored in 4 bytes) without changing what the shader sees.
+
+constexpr unsigned int glTypeSize(GLenum type)
+{
+    return type == GL_FLOAT ? 4u
+         : type == GL_HALF_FLOAT ? 2u
+         : type == GL_SHORT || type == GL_UNSIGNED_SHORT ? 2u
+         : type == GL_BYTE || type == GL_UNSIGNED_BYTE ? 1u
+         : 0u;
+}
+
+template <GLuint Location, GLenum Type, GLint Components, bool Normalized = false, GLint StorageComponents = Components>
+struct VertexAttribute
+{
+    static_assert(glTypeSize(Type) != 0, "unsupported vertex attribute type");
+    static_assert(Components >= 1 && Components <= 4, "attribute must have 1 to 4 components");
+    static_assert(StorageComponents >= Components && StorageComponents <= 4, "storage must hold every component");
+
+    static constexpr GLuint location = Location;
+    static constexpr GLenum type = Type;
+    static constexpr GLint components = Components;
+    static constexpr GLint storageComponents = StorageComponents;
+    static constexpr GLboolean normalized = Normalized ? GL_TRUE : GL_FALSE;
+    static constexpr unsigned int size = glTypeSize(Type) * StorageComponents;
+};
+
+// Converts one float stream (components floats per vertex) into the
+// attribute's storage type, writing dstStride bytes apart.
+template <typename Attribute>
+void convertAttributeStream(const float* src, size_t count, unsigned char* dst, size_t dstStride)
+{
+    constexpr size_t storage = Attribute::storageComponents;
+    constexpr size_t elementSize = glTypeSize(Attribute::type);
+
+    std::vector<float> padded;
+    if constexpr (Attribute::storageComponents != Attribute::components)
+    {
+        padded.assign(count * storage, 0.0f);
+        for (size_t i = 0; i < count; ++i)
+            std::memcpy(&padded[i * storage], src + i * Attribute::components, Attribute::components * sizeof(float));
+        src = padded.data();
+    }
+
+    std::vector<unsigned char> scratch;
+    unsigned char* out = dst;
+    if (dstStride != Attribute::size)
+    {
+        scratch.resize(count * Attribute::size);
+        out = scratch.data();
+    }
+
+    size_t n = count * storage;
+    if constexpr (Attribute::type == GL_FLOAT)
+        std::memcpy(out, src, n * elementSize);
+    else if constexpr (Attribute::type == GL_HALF_FLOAT)
+        convertFloatToHalf(src, (uint16_t*)out, n);
+    else if constexpr (Attribute::type == GL_SHORT && Attribute::normalized)
+        convertFloatToSnorm16(src, (int16_t*)out, n);
+    else if constexpr (Attribute::type == GL_UNSIGNED_BYTE && Attribute::normalized)
+        convertFloatToUnorm8(src, (uint8_t*)out, n);
+    else
+        static_assert(Attribute::type == GL_FLOAT, "no float conversion for this attribute type");
+
+    if (out != dst)
+    {
+        for (size_t i = 0; i < count; ++i)
+            std::memcpy(dst + i * dstStride, out + i * Attribute::size, Attribute::size);
+    }
+}
+
+inline GLint glslTypeComponents(GLenum type)
+{
+    switch (type)
+    {
+    case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: return 1;
+    case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: return 2;
+    case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: return 3;
+    case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: return 4;
+    default: return 0;
+    }
+}
+
+template <typename... Attributes>
+struct VertexLayout
+{
+    static constexpr size_t attributeCount = sizeof...(Attributes);
+    static constexpr unsigned int stride = (Attributes::size + ...);
+    static constexpr std::array<GLuint, attributeCount> locations = { Attributes::location... };
+    static constexpr std::array<unsigned int, attributeCount> sizes = { Attributes::size... };
+
+    static constexpr std::array<unsigned int, attributeCount> computeOffsets()
+    {
+        std::array<unsigned int, attributeCount> result = {};
+        unsigned int offset = 0;
+        for (size_t i = 0; i < attributeCount; ++i)
+        {
+            result[i] = offset;
+            offset += sizes[i];
+        }
+        return result;
+    }
+
+    static constexpr bool locationsUnique()
+    {
+        for (size_t i = 0; i < attributeCount; ++i)
+            for (size_t j = i + 1; j < attributeCount; ++j)
+                if (locations[i] == locations[j])
+                    return false;
+        return true;
+    }
+
+    static constexpr std::array<unsigned int, attributeCount> offsets = computeOffsets();
+    static_assert(locationsUnique(), "vertex layout declares a location twice");
+
+    // Interleaved: one buffer, one vertex after another.
+    static void apply(size_t baseOffset = 0)
+    {
+        applyImpl(std::index_sequence_for<Attributes...>{}, baseOffset, false, 0);
+    }
+
+    // Planar: each attribute occupies its own block of vertexCount elements.
+    static void applySoA(size_t vertexCount, size_t baseOffset = 0)
+    {
+        applyImpl(std::index_sequence_for<Attributes...>{}, baseOffset, true, vertexCount);
+    }
+
+    // streams[i] holds Attribute i's components as floats, tightly packed.
+    static void packAoS(const float* const* streams, size_t count, std::vector<unsigned char>& out)
+    {
+        out.resize(count * stride);
+        packImpl(std::index_sequence_for<Attributes...>{}, streams, count, out.data(), false);
+    }
+
+    static void packSoA(const float* const* streams, size_t count, std::vector<unsigned char>& out)
+    {
+        out.resize(count * stride);
+        packImpl(std::index_sequence_for<Attributes...>{}, streams, count, out.data(), true);
+    }
+
+    // Compares against the program's active attributes; every attribute the
+    // shader reads must be supplied with a matching component count.
+    static bool matchesProgram(unsigned int program)
+    {
+        GLint activeCount = 0;
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &activeCount);
+
+        bool ok = true;
+        for (GLint i = 0; i < activeCount; ++i)
+        {
+            char name[256];
+            GLint arraySize = 0;
+            GLenum glslType = 0;
+            glGetActiveAttrib(program, (GLuint)i, sizeof(name), NULL, &arraySize, &glslType, name);
+            if (std::strncmp(name, "gl_", 3) == 0)
+                continue;
+
+            GLint location = glGetAttribLocation(program, name);
+            GLint expected = -1;
+            for (size_t a = 0; a < attributeCount; ++a)
+                if ((GLint)locations[a] == location)
+                    expected = componentsAt(a);
+
+            if (expected < 0 || glslTypeComponents(glslType) > expected)
+            {
+                std::cout << "ERROR::VERTEX_LAYOUT::ATTRIBUTE_MISMATCH: " << name
+                    << " at location " << location << std::endl;
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+private:
+    static constexpr GLint componentsAt(size_t index)
+    {
+        constexpr std::array<GLint, attributeCount> components = { Attributes::components... };
+        return components[index];
+    }
+
+    template <size_t... I>
+    static void applyImpl(std::index_sequence<I...>, size_t baseOffset, bool planar, size_t vertexCount)
+    {
+        (setPointer<Attributes>(planar
+            ? baseOffset + offsets[I] * vertexCount
+            : baseOffset + offsets[I], planar ? Attributes::size : stride), ...);
+    }
+
+    template <typename Attribute>
+    static void setPointer(size_t offset, GLsizei attributeStride)
+    {
+        glVertexAttribPointer(Attribute::location, Attribute::components, Attribute::type,
+            Attribute::normalized, attributeStride, (void*)offset);
+        glEnableVertexAttribArray(Attribute::location);
+    }
+
+    template <size_t... I>
+    static void packImpl(std::index_sequence<I...>, const float* const* streams, size_t count, unsigned char* dst, bool planar)
+    {
+        (convertAttributeStream<Attributes>(streams[I], count,
+            planar ? dst + offsets[I] * count : dst + offsets[I],
+            planar ? Attributes::size : stride), ...);
+    }
+};
+
+#endif
@@ -0,0 +1,383 @@
+#include "VirtualTexture.h"
+#include "GpuMemory.h"
+#include "Resample.h"
+#include "Texture.h"
+#include "stb_image.h"
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+bool buildTileFile(const char* imagePath, const char* tilePath, int tileSize, int border)
+{
+    int width, height, channels;
+    unsigned char* data = decodeImage(imagePath, width, height, channels, 4);
+    if (!data)
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::IMAGE_NOT_LOADED: " << imagePath << std::endl;
+        return false;
+    }
+
+    // Level 0 is padded to a power-of-two number of tiles per axis so that
+    // every level has exactly half the tiles of the one before.
+    int tiles = std::max((width + tileSize - 1) / tileSize, (height + tileSize - 1) / tileSize);
+    unsigned int gridSize = 1;
+    while ((int)gridSize < tiles)
+        gridSize <<= 1;
+
+    VirtualTextureHeader header = {};
+    memcpy(header.magic, "VTEX", 4);
+    header.version = 1;
+    header.width = width;
+    header.height = height;
+    header.tileSize = tileSize;
+    header.border = border;
+    header.gridSize = gridSize;
+    for (unsigned int grid = gridSize; grid > 0; grid >>= 1)
+        header.levels += 1;
+
+    int pageSize = tileSize + 2 * border;
+    size_t tileBytes = (size_t)pageSize * pageSize * 4;
+    std::vector<VirtualTextureLevel> levels(header.levels);
+    unsigned long long offset = sizeof(header) + levels.size() * sizeof(VirtualTextureLevel);
+    for (unsigned int level = 0; level < header.levels; ++level)
+    {
+        int levelWidth = std::max(1, width >> level);
+        int levelHeight = std::max(1, height >> level);
+        levels[level].tilesX = (levelWidth + tileSize - 1) / tileSize;
+        levels[level].tilesY = (levelHeight + tileSize - 1) / tileSize;
+        levels[level].offset = offset;
+        offset += (unsigned long long)levels[level].tilesX * levels[level].tilesY * tileBytes;
+    }
+
+    std::ofstream out(tilePath, std::ios::binary);
+    if (!out)
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::FILE_NOT_WRITTEN: " << tilePath << std::endl;
+        stbi_image_free(data);
+        return false;
+    }
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)levels.data(), levels.size() * sizeof(VirtualTextureLevel));
+
+    std::vector<unsigned char> image(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+    std::vector<unsigned char> tile(tileBytes);
+    int levelWidth = width;
+    int levelHeight = height;
+    for (unsigned int level = 0; level < header.levels; ++level)
+    {
+        for (unsigned int ty = 0; ty < levels[level].tilesY; ++ty)
+        {
+            for (unsigned int tx = 0; tx < levels[level].tilesX; ++tx)
+            {
+                // Border and out-of-image texels clamp to the image edge.
+                for (int j = 0; j < pageSize; ++j)
+                {
+                    int sy = std::min(std::max((int)ty * tileSize - border + j, 0), levelHeight - 1);
+                    for (int i = 0; i < pageSize; ++i)
+                    {
+                        int sx = std::min(std::max((int)tx * tileSize - border + i, 0), levelWidth - 1);
+                        memcpy(&tile[((size_t)j * pageSize + i) * 4], &image[((size_t)sy * levelWidth + sx) * 4], 4);
+                    }
+                }
+                out.write((const char*)tile.data(), tile.size());
+            }
+        }
+
+        if (level + 1 < header.levels)
+        {
+            int nextWidth = std::max(1, levelWidth / 2);
+            int nextHeight = std::max(1, levelHeight / 2);
+            std::vector<unsigned char> next((size_t)nextWidth * nextHeight * 4);
+            resampleImage(image.data(), levelWidth, levelHeight, 4, next.data(), nextWidth, nextHeight,
+                ResampleMitchell, &ThreadPool::shared());
+            image.swap(next);
+            levelWidth = nextWidth;
+            levelHeight = nextHeight;
+        }
+    }
+    return out.good();
+}
+
+VirtualTexture::VirtualTexture(int pagesPerAxis, int uploads)
+    : cachePages(std::max(pagesPerAxis, 1)), uploadsPerFrame(std::max(uploads, 1))
+{
+}
+
+// Checks every level against what buildTileFile writes and against the
+// file size, so neither a tile read nor an allocation can run away.
+bool VirtualTexture::validLevels(GLint maxTextureSize) const
+{
+    const unsigned int maxGrid = 1u << 24;    // tileKey packs 24 bits per axis
+    if (header.tileSize == 0 || header.tileSize > (unsigned int)maxTextureSize ||
+        header.border > header.tileSize || header.width == 0 || header.height == 0)
+        return false;
+    if (header.gridSize == 0 || header.gridSize > maxGrid || (header.gridSize & (header.gridSize - 1)) != 0 ||
+        header.gridSize > (unsigned int)maxTextureSize)
+        return false;
+    unsigned long long virtualSize = (unsigned long long)header.gridSize * header.tileSize;
+    if (header.width > virtualSize || header.height > virtualSize)
+        return false;
+    unsigned int levelCount = 0;
+    for (unsigned int grid = header.gridSize; grid > 0; grid >>= 1)
+        levelCount += 1;
+    if (header.levels != levelCount || pageSize > maxTextureSize)
+        return false;
+
+    unsigned long long tileBytes = (unsigned long long)pageSize * pageSize * 4;
+    unsigned long long tableEnd = sizeof(VirtualTextureHeader) + levels.size() * sizeof(VirtualTextureLevel);
+    for (size_t level = 0; level < levels.size(); ++level)
+    {
+        const VirtualTextureLevel& info = levels[level];
+        unsigned long long levelW = std::max(1u, header.width >> level);
+        unsigned long long levelH = std::max(1u, header.height >> level);
+        if (info.tilesX != (levelW + header.tileSize - 1) / header.tileSize ||
+            info.tilesY != (levelH + header.tileSize - 1) / header.tileSize)
+            return false;
+        // tilesX, tilesY and pageSize are bounded by the texture size limit,
+        // so this cannot overflow.
+        unsigned long long levelBytes = (unsigned long long)info.tilesX * info.tilesY * tileBytes;
+        if (info.offset < tableEnd || info.offset > file.size() || levelBytes > file.size() - info.offset)
+            return false;
+    }
+    return true;
+}
+
+bool VirtualTexture::open(const char* tilePath)
+{
+    if (!file.open(tilePath) || file.size() < sizeof(VirtualTextureHeader))
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::FILE_NOT_OPENED: " << tilePath << std::endl;
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, "VTEX", 4) != 0 || header.version != 1 || header.levels == 0 || header.levels > 25 ||
+        file.size() < sizeof(header) + (size_t)header.levels * sizeof(VirtualTextureLevel))
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::INVALID_FILE: " << tilePath << std::endl;
+        file.close();
+        return false;
+    }
+    levels.resize(header.levels);
+    memcpy(levels.data(), file.data() + sizeof(header), levels.size() * sizeof(VirtualTextureLevel));
+
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    pageSize = (int)std::min(header.tileSize + 2ull * header.border, (unsigned long long)INT_MAX);
+    if (!validLevels(maxTextureSize))
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::INVALID_LEVELS: " << tilePath << std::endl;
+        levels.clear();
+        file.close();
+        return false;
+    }
+
+    cachePages = std::min(cachePages, std::max(1, maxTextureSize / pageSize));
+    int cacheSize = cachePages * pageSize;
+
+    cache = TextureObject::create();
+    glBindTexture(GL_TEXTURE_2D, cache.id());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheSize, cacheSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    GpuMemory::shared().record(GpuTexture, cache.id(), GpuMemoryTextures, textureMemorySize(cacheSize, cacheSize, GL_RGBA, false));
+
+    indirection = TextureObject::create();
+    glBindTexture(GL_TEXTURE_2D, indirection.id());
+    indirectionLevels.assign(levels.size(), std::vector<unsigned char>());
+    for (size_t level = 0; level < levels.size(); ++level)
+    {
+        int grid = std::max(1, (int)header.gridSize >> level);
+        indirectionLevels[level].assign((size_t)grid * grid * 4, 0);
+        glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA8, grid, grid, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+    GpuMemory::shared().record(GpuTexture, indirection.id(), GpuMemoryTextures,
+        textureMemorySize(header.gridSize, header.gridSize, GL_RGBA, true));
+
+    pages.assign((size_t)cachePages * cachePages, Page());
+    resident.clear();
+    pending.clear();
+
+    // The coarsest tile's refresh covers every texel of every level.
+    int coarsest = (int)levels.size() - 1;
+    loadTile(tileKey(coarsest, 0, 0));
+    pages[resident[tileKey(coarsest, 0, 0)]].locked = true;
+    return true;
+}
+
+void VirtualTexture::requestRegion(float u0, float v0, float u1, float v1, int level)
+{
+    if (levels.empty())
+        return;
+    level = std::min(std::max(level, 0), (int)levels.size() - 1);
+    const VirtualTextureLevel& info = levels[level];
+    float tileSize = (float)header.tileSize;
+
+    int x0 = std::max(0, (int)(std::min(u0, u1) * levelWidth(level) / tileSize));
+    int x1 = std::min((int)info.tilesX - 1, (int)(std::max(u0, u1) * levelWidth(level) / tileSize));
+    int y0 = std::max(0, (int)(std::min(v0, v1) * levelHeight(level) / tileSize));
+    int y1 = std::min((int)info.tilesY - 1, (int)(std::max(v0, v1) * levelHeight(level) / tileSize));
+    for (int y = y0; y <= y1; ++y)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            unsigned long long key = tileKey(level, x, y);
+            std::unordered_map<unsigned long long, int>::iterator it = resident.find(key);
+            if (it != resident.end())
+                pages[it->second].lastUsed = frame;
+            else
+                pending.insert(key);
+        }
+    }
+}
+
+int VirtualTexture::levelFor(float uvExtent, float screenPixels) const
+{
+    float texels = uvExtent * header.width;
+    if (levels.empty() || screenPixels <= 0.0f || texels <= screenPixels)
+        return 0;
+    return std::min((int)std::floor(std::log2(texels / screenPixels)), (int)levels.size() - 1);
+}
+
+bool VirtualTexture::loadTile(unsigned long long key)
+{
+    int page = -1;
+    for (size_t i = 0; i < pages.size(); ++i)
+    {
+        if (pages[i].locked || pages[i].lastUsed >= frame)
+            continue;
+        if (pages[i].key == ~0ull)
+        {
+            page = (int)i;
+            break;
+        }
+        if (page < 0 || pages[i].lastUsed < pages[page].lastUsed)
+            page = (int)i;
+    }
+    if (page < 0)
+        return false;
+
+    unsigned long long previous = pages[page].key;
+    if (previous != ~0ull)
+    {
+        resident.erase(previous);
+        evicted += 1;
+    }
+
+    int level = (int)(key >> 48);
+    int y = (int)((key >> 24) & 0xFFFFFF);
+    int x = (int)(key & 0xFFFFFF);
+    size_t tileBytes = (size_t)pageSize * pageSize * 4;
+    const unsigned char* tile = file.data() + levels[level].offset + ((size_t)y * levels[level].tilesX + x) * tileBytes;
+
+    // Tiles go straight from the mapping to the driver.
+    glBindTexture(GL_TEXTURE_2D, cache.id());
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (page % cachePages) * pageSize, (page / cachePages) * pageSize,
+        pageSize, pageSize, GL_RGBA, GL_UNSIGNED_BYTE, tile);
+
+    pages[page].key = key;
+    pages[page].lastUsed = frame;
+    resident[key] = page;
+    loads += 1;
+    if (previous != ~0ull)
+        refreshIndirection(previous);
+    refreshIndirection(key);
+    return true;
+}
+
+void VirtualTexture::update()
+{
+    if (!pending.empty())
+    {
+        // Coarse tiles first: they cover the most screen and every finer
+        // tile falls back to them.
+        std::vector<unsigned long long> requests(pending.begin(), pending.end());
+        std::sort(requests.begin(), requests.end(), [](unsigned long long a, unsigned long long b) {
+            return (a >> 48) != (b >> 48) ? (a >> 48) > (b >> 48) : a < b;
+        });
+        int uploads = std::min((int)requests.size(), uploadsPerFrame);
+        for (int i = 0; i < uploads; ++i)
+        {
+            if (!loadTile(requests[i]))
+                break;
+        }
+        // Whatever did not fit is requested again next frame if still needed.
+        pending.clear();
+    }
+    ++frame;
+}
+
+void VirtualTexture::refreshIndirection(unsigned long long key)
+{
+    int tileLevel = (int)(key >> 48);
+    int tileY = (int)((key >> 24) & 0xFFFFFF);
+    int tileX = (int)(key & 0xFFFFFF);
+
+    glBindTexture(GL_TEXTURE_2D, indirection.id());
+    for (int level = tileLevel; level >= 0; --level)
+    {
+        // The tile covers a square of texels that doubles per finer level.
+        // Each texel points at its own resident tile, else copies its
+        // parent, which was refreshed one step earlier.
+        int grid = std::max(1, (int)header.gridSize >> level);
+        int shift = tileLevel - level;
+        int x0 = tileX << shift;
+        int y0 = tileY << shift;
+        int x1 = std::min(grid, (tileX + 1) << shift);
+        int y1 = std::min(grid, (tileY + 1) << shift);
+        if (x0 >= x1 || y0 >= y1)
+            break;
+
+        std::vector<unsigned char>& texels = indirectionLevels[level];
+        int parentGrid = std::max(1, grid / 2);
+        for (int y = y0; y < y1; ++y)
+        {
+            for (int x = x0; x < x1; ++x)
+            {
+                unsigned char* texel = &texels[((size_t)y * grid + x) * 4];
+                std::unordered_map<unsigned long long, int>::const_iterator it = resident.find(tileKey(level, x, y));
+                if (it != resident.end())
+                {
+                    texel[0] = (unsigned char)(it->second % cachePages);
+                    texel[1] = (unsigned char)(it->second / cachePages);
+                    texel[2] = (unsigned char)level;
+                    texel[3] = 255;
+                }
+                else if (level + 1 < (int)levels.size())
+                {
+                    const std::vector<unsigned char>& parent = indirectionLevels[level + 1];
+                    memcpy(texel, &parent[((size_t)(y / 2) * parentGrid + x / 2) * 4], 4);
+                }
+            }
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, grid);
+        glTexSubImage2D(GL_TEXTURE_2D, level, x0, y0, x1 - x0, y1 - y0, GL_RGBA, GL_UNSIGNED_BYTE,
+            &texels[((size_t)y0 * grid + x0) * 4]);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+}
+
+void VirtualTexture::bind(const Shader& shader, unsigned int cacheUnit, unsigned int indirectionUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + cacheUnit);
+    glBindTexture(GL_TEXTURE_2D, cache.id());
+    glActiveTexture(GL_TEXTURE0 + indirectionUnit);
+    glBindTexture(GL_TEXTURE_2D, indirection.id());
+
+    float virtualSize = (float)header.gridSize * header.tileSize;
+    shader.setInt("physicalCache", (int)cacheUnit);
+    shader.setInt("indirection", (int)indirectionUnit);
+    shader.setFloat("virtualSize", virtualSize);
+    glUniform2f(glGetUniformLocation(shader.id(), "contentScale"), header.width / virtualSize, header.height / virtualSize);
+    shader.setFloat("tileSize", (float)header.tileSize);
+    shader.setFloat("tileBorder", (float)header.border);
+    shader.setFloat("maxLevel", (float)(levels.size() - 1));
+    shader.setFloat("cacheSize", (float)(cachePages * pageSize));
+}
@@ -0,0 +1,117 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include <glad/glad.h>
+#include "GpuResources.h"
+#include "MappedFile.h"
+#include "Shader.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Tile file layout: header, one VirtualTextureLevel per mip level, then the
+// tiles of every level in row-major order. Each tile is RGBA8 and
+// (tileSize + 2 * border) texels square; the border repeats neighbouring
+// texels so the cache can be sampled bilinearly across tile edges.
+struct VirtualTextureHeader
+{
+    char magic[4];
+    unsigned int version;
+    unsigned int width;
+    unsigned int height;
+    unsigned int tileSize;
+    unsigned int border;
+    unsigned int levels;
+    unsigned int gridSize;    // tiles per axis of the padded level 0
+};
+
+struct VirtualTextureLevel
+{
+    unsigned int tilesX;
+    unsigned int tilesY;
+    unsigned long long offset;
+};
+
+// Offline step: decodes imagePath, builds its mip chain and writes every
+// level as tiles. Runs on a build machine, so it holds the whole decoded
+// image, plus the next level while resampling, in memory; the runtime only
+// maps the tile file.
+bool buildTileFile(const char* imagePath, const char* tilePath, int tileSize = 128, int border = 4);
+
+// Texture of any size backed by a memory-mapped tile file. Resident tiles
+// live in pages of one physical cache texture; an indirection texture with
+// one texel per tile and one mip level per tile level maps each tile to
+// its page, or to the page of its nearest resident ancestor. The coarsest
+// tile is loaded on open and never evicted, so every lookup resolves.
+// Sample it with 3.3.virtual.fs.
+class VirtualTexture
+{
+public:
+    // The cache holds cachePages x cachePages tiles; update() uploads at
+    // most uploadsPerFrame of them.
+    explicit VirtualTexture(int cachePages = 16, int uploadsPerFrame = 8);
+
+    bool open(const char* tilePath);
+
+    // Marks the tiles covering a uv rectangle (image space, [0, 1]) at a
+    // level as needed this frame.
+    void requestRegion(float u0, float v0, float u1, float v1, int level);
+
+    // Level a region spanning uvExtent of the image needs when drawn
+    // across screenPixels.
+    int levelFor(float uvExtent, float screenPixels) const;
+
+    // Loads requested tiles, coarsest first, evicting the least recently
+    // requested pages, then refreshes the indirection texture.
+    void update();
+
+    void bind(const Shader& shader, unsigned int cacheUnit, unsigned int indirectionUnit) const;
+
+    int levelCount() const { return (int)levels.size(); }
+    size_t residentTiles() const { return resident.size(); }
+    size_t tileLoads() const { return loads; }
+    size_t evictions() const { return evicted; }
+
+private:
+    struct Page
+    {
+        unsigned long long key = ~0ull;
+        unsigned long long lastUsed = 0;
+        bool locked = false;
+    };
+
+    static unsigned long long tileKey(int level, int x, int y)
+    {
+        return ((unsigned long long)level << 48) | ((unsigned long long)y << 24) | (unsigned long long)x;
+    }
+
+    int levelWidth(int level) const { return std::max(1, (int)header.width >> level); }
+    int levelHeight(int level) const { return std::max(1, (int)header.height >> level); }
+    bool validLevels(GLint maxTextureSize) const;
+    bool loadTile(unsigned long long key);
+    // Recomputes the indirection texels a change to the tile at key affects
+    // (its own and those of finer levels that fall back to it) and uploads
+    // just those.
+    void refreshIndirection(unsigned long long key);
+
+    MappedFile file;
+    VirtualTextureHeader header = {};
+    std::vector<VirtualTextureLevel> levels;
+    int pageSize = 0;
+    int cachePages;
+    int uploadsPerFrame;
+
+    TextureObject cache;
+    TextureObject indirection;
+    std::vector<std::vector<unsigned char>> indirectionLevels;
+
+    std::vector<Page> pages;
+    std::unordered_map<unsigned long long, int> resident;
+    std::unordered_set<unsigned long long> pending;
+    unsigned long long frame = 1;
+    size_t loads = 0;
+    size_t evicted = 0;
+};
+
+#endif
@@ -1,2 +1,28 @@
+#include "DecodePool.h"
+#include "JpegSimd.h"
+
+#define STBI_MALLOC(size) decodeAllocate(size)
+#define STBI_REALLOC(pointer, size) decodeReallocate(pointer, size)
+#define STBI_FREE(pointer) decodeFree(pointer)
+
+// stb has no hook for its JPEG colour conversion, so convertYCbCrToRgb is
+// installed without touching stb_image.h: these function-like macros rename
+// stb's kernel definitions, while the bare names assigned in
+// stbi__setup_jpeg (no parentheses follow them) resolve to the pointers below.
+#define stbi__YCbCr_to_RGB_row(...) stbi__YCbCr_to_RGB_row_stock(__VA_ARGS__)
+#define stbi__YCbCr_to_RGB_simd(...) stbi__YCbCr_to_RGB_simd_stock(__VA_ARGS__)
+typedef void (*YCbCrToRgbKernel)(unsigned char*, const unsigned char*, const unsigned char*, const unsigned char*, int, int);
+static const YCbCrToRgbKernel stbi__YCbCr_to_RGB_row = convertYCbCrToRgb;
+static const YCbCrToRgbKernel stbi__YCbCr_to_RGB_simd = convertYCbCrToRgb;
+
 #define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
\ No newline at end of file
+#include "stb_image.h"
+
+// Keeps the renamed stock kernels referenced so -Wunused-function stays quiet.
+static const YCbCrToRgbKernel stockKernels[] =
+{
+    stbi__YCbCr_to_RGB_row_stock,
+#if defined(STBI_SSE2) || defined(STBI_NEON)
+    stbi__YCbCr_to_RGB_simd_stock,
+#endif
+};